@@ -0,0 +1,394 @@
+/**********************************************************************
+ *  blockdevice.cpp
+ **********************************************************************
+ *              Copyright (C) 2025 danko12
+ *
+ *             Author: danko12
+ *          Enhanced cross-platform USB formatting tool
+ *            Modern GUI with improved USB detection
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "blockdevice.h"
+
+#include <QRandomGenerator>
+#include <QStringList>
+#include <QThread>
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+QString systemError(int err)
+{
+    return QString::fromLocal8Bit(strerror(err));
+}
+
+// "512", "4K", "20M", "64G", "2T" -> bytes
+qint64 parseSize(QString value, bool *ok)
+{
+    static const QString suffixes = "KMGT";
+    qint64 factor = 1;
+    value = value.trimmed().toUpper();
+    if (value.endsWith('B')) {
+        value.chop(1);
+    }
+    const int unit = value.isEmpty() ? -1 : suffixes.indexOf(value.back());
+    if (unit >= 0) {
+        value.chop(1);
+        factor = qint64(1) << (10 * (unit + 1));
+    }
+    return qint64(value.toDouble(ok) * factor);
+}
+
+// "250us", "2ms", "1s" -> microseconds
+qint64 parseDuration(QString value, bool *ok)
+{
+    value = value.trimmed().toLower();
+    qint64 factor = 1;
+    if (value.endsWith("us")) {
+        value.chop(2);
+    } else if (value.endsWith("ms")) {
+        value.chop(2);
+        factor = 1000;
+    } else if (value.endsWith('s')) {
+        value.chop(1);
+        factor = 1000000;
+    }
+    return qint64(value.toDouble(ok) * factor);
+}
+}
+
+std::unique_ptr<BlockDevice> BlockDevice::open(const QString &spec, bool writable, QString *error)
+{
+    QString path = spec;
+    QString simulation;
+    const bool simulated = path.startsWith("sim:");
+
+    if (simulated) {
+        path = path.mid(4);
+        const int query = path.indexOf('?');
+        if (query >= 0) {
+            simulation = path.mid(query + 1);
+            path.truncate(query);
+        }
+    }
+    if (!path.contains('/')) {
+        path.prepend("/dev/");
+    }
+
+    auto device = std::make_unique<FileBlockDevice>(path, writable);
+    if (!device->isOpen()) {
+        if (error) {
+            *error = device->errorString();
+        }
+        return nullptr;
+    }
+    if (!simulated) {
+        return device;
+    }
+
+    bool ok = true;
+    const SimulationProfile profile = SimulationProfile::fromString(simulation, &ok);
+    if (!ok) {
+        if (error) {
+            *error = QString("Invalid simulation profile: %1").arg(simulation);
+        }
+        return nullptr;
+    }
+    return std::make_unique<SimulatedBlockDevice>(std::move(device), profile);
+}
+
+FileBlockDevice::FileBlockDevice(const QString &path, bool writable)
+    : filePath(path)
+{
+    fd = ::open(path.toLocal8Bit().constData(), (writable ? O_RDWR : O_RDONLY) | O_CLOEXEC);
+    if (fd < 0) {
+        error = QString("%1: %2").arg(path, systemError(errno));
+        return;
+    }
+
+    struct stat st {};
+    fstat(fd, &st);
+    blockDevice = S_ISBLK(st.st_mode);
+    if (blockDevice) {
+        quint64 size64 = 0;
+        ioctl(fd, BLKGETSIZE64, &size64);
+        bytes = qint64(size64);
+        ioctl(fd, BLKSSZGET, &sector);
+    } else {
+        bytes = st.st_size;
+    }
+}
+
+FileBlockDevice::~FileBlockDevice()
+{
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+qint64 FileBlockDevice::read(qint64 offset, char *data, qint64 len)
+{
+    qint64 done = 0;
+    while (done < len) {
+        const ssize_t n = pread(fd, data + done, size_t(len - done), off_t(offset + done));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            error = QString("read %1 at %2: %3").arg(filePath).arg(offset + done).arg(systemError(errno));
+            return -1;
+        }
+        if (n == 0) {
+            break; // end of device
+        }
+        done += n;
+    }
+    return done;
+}
+
+qint64 FileBlockDevice::write(qint64 offset, const char *data, qint64 len)
+{
+    qint64 done = 0;
+    while (done < len) {
+        const ssize_t n = pwrite(fd, data + done, size_t(len - done), off_t(offset + done));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            error = QString("write %1 at %2: %3").arg(filePath).arg(offset + done).arg(systemError(n < 0 ? errno : ENOSPC));
+            return -1;
+        }
+        done += n;
+    }
+    if (!blockDevice) {
+        bytes = qMax(bytes, offset + done);
+    }
+    return done;
+}
+
+bool FileBlockDevice::discard(qint64 offset, qint64 len)
+{
+    int rc;
+    if (blockDevice) {
+        quint64 range[2] = {quint64(offset), quint64(len)};
+        rc = ioctl(fd, BLKDISCARD, &range);
+    } else {
+        // image files get a hole, which reads back as zeros
+        rc = fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, off_t(offset), off_t(len));
+    }
+    if (rc != 0) {
+        error = QString("discard %1: %2").arg(filePath, systemError(errno));
+        return false;
+    }
+    return true;
+}
+
+bool FileBlockDevice::zeroOut(qint64 offset, qint64 len)
+{
+    int rc;
+    if (blockDevice) {
+        // WRITE ZEROES where the drive has it, otherwise the kernel writes zero pages
+        quint64 range[2] = {quint64(offset), quint64(len)};
+        rc = ioctl(fd, BLKZEROOUT, &range);
+    } else {
+        rc = fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, off_t(offset), off_t(len));
+    }
+    if (rc != 0) {
+        error = QString("zero out %1: %2").arg(filePath, systemError(errno));
+        return false;
+    }
+    return true;
+}
+
+bool FileBlockDevice::flush()
+{
+    // on a block device fsync also sends a cache flush to the drive
+    if (fsync(fd) != 0) {
+        error = QString("flush %1: %2").arg(filePath, systemError(errno));
+        return false;
+    }
+    return true;
+}
+
+SimulationProfile SimulationProfile::fromString(const QString &spec, bool *ok)
+{
+    SimulationProfile profile;
+    bool valid = true;
+
+    for (const QString &option : spec.split(',', Qt::SkipEmptyParts)) {
+        const QString key = option.section('=', 0, 0).trimmed();
+        const QString value = option.section('=', 1);
+        bool parsed = false;
+
+        if (key == "capacity") {
+            profile.capacity = parseSize(value, &parsed);
+        } else if (key == "latency") {
+            profile.latencyUs = parseDuration(value, &parsed);
+        } else if (key == "throughput") {
+            profile.throughput = parseSize(value, &parsed);
+        } else if (key == "fail-at") {
+            profile.failAt = parseSize(value, &parsed);
+        } else if (key == "fail-length") {
+            profile.failLength = parseSize(value, &parsed);
+        } else if (key == "error-rate") {
+            profile.errorRate = value.toDouble(&parsed);
+        } else if (key == "no-discard") {
+            profile.discard = false;
+            parsed = value.isEmpty();
+        }
+        valid = valid && parsed;
+    }
+
+    if (ok) {
+        *ok = valid;
+    }
+    return profile;
+}
+
+SimulatedBlockDevice::SimulatedBlockDevice(std::unique_ptr<BlockDevice> backend, const SimulationProfile &profile)
+    : backend(std::move(backend)),
+      profile(profile)
+{
+    clock.start();
+}
+
+qint64 SimulatedBlockDevice::size() const
+{
+    return profile.capacity > 0 ? profile.capacity : backend->size();
+}
+
+// beyond the real storage a counterfeit stick wraps around onto its first blocks
+qint64 SimulatedBlockDevice::backendOffset(qint64 offset) const
+{
+    const qint64 real = backend->size();
+    return (profile.capacity > real && real > 0) ? offset % real : offset;
+}
+
+// sleep until the request fits the latency and throughput budget
+void SimulatedBlockDevice::throttle(qint64 len)
+{
+    qint64 waitUs = profile.latencyUs;
+    transferred += len;
+    if (profile.throughput > 0) {
+        const qint64 dueUs = transferred * 1000000 / profile.throughput;
+        waitUs += qMax<qint64>(0, dueUs - clock.nsecsElapsed() / 1000);
+    }
+    if (waitUs > 0) {
+        QThread::usleep(quint64(waitUs));
+    }
+}
+
+bool SimulatedBlockDevice::injectWriteError(qint64 offset, qint64 len)
+{
+    const bool badRange = profile.failAt >= 0 && offset < profile.failAt + profile.failLength
+                          && offset + len > profile.failAt;
+    const bool unlucky = profile.errorRate > 0 && QRandomGenerator::global()->generateDouble() < profile.errorRate;
+    if (badRange || unlucky) {
+        error = QString("write %1 at %2: %3 (simulated)").arg(path()).arg(offset).arg(systemError(EIO));
+        return true;
+    }
+    return false;
+}
+
+qint64 SimulatedBlockDevice::read(qint64 offset, char *data, qint64 len)
+{
+    len = qMax<qint64>(0, qMin(len, size() - offset));
+    throttle(len);
+
+    qint64 done = 0;
+    while (done < len) {
+        // split requests at the wrap point of a fake capacity
+        const qint64 start = backendOffset(offset + done);
+        const qint64 chunk = qMin(len - done, backend->size() - start);
+        const qint64 n = backend->read(start, data + done, chunk);
+        if (n <= 0) {
+            error = backend->errorString();
+            return n < 0 ? -1 : done;
+        }
+        done += n;
+    }
+    return done;
+}
+
+qint64 SimulatedBlockDevice::write(qint64 offset, const char *data, qint64 len)
+{
+    len = qMax<qint64>(0, qMin(len, size() - offset));
+    throttle(len);
+    if (injectWriteError(offset, len)) {
+        return -1;
+    }
+
+    qint64 done = 0;
+    while (done < len) {
+        const qint64 start = backendOffset(offset + done);
+        const qint64 chunk = qMin(len - done, backend->size() - start);
+        const qint64 n = backend->write(start, data + done, chunk);
+        if (n <= 0) {
+            error = backend->errorString();
+            return -1;
+        }
+        done += n;
+    }
+    return done;
+}
+
+bool SimulatedBlockDevice::discard(qint64 offset, qint64 len)
+{
+    throttle(0);
+    if (!profile.discard) {
+        error = QString("discard %1: %2 (simulated)").arg(path(), systemError(EOPNOTSUPP));
+        return false;
+    }
+    if (!backend->discard(backendOffset(offset), qMin(len, backend->size() - backendOffset(offset)))) {
+        error = backend->errorString();
+        return false;
+    }
+    return true;
+}
+
+bool SimulatedBlockDevice::zeroOut(qint64 offset, qint64 len)
+{
+    throttle(0);
+    if (!profile.discard) {
+        error = QString("zero out %1: %2 (simulated)").arg(path(), systemError(EOPNOTSUPP));
+        return false;
+    }
+    if (injectWriteError(offset, len)) {
+        return false;
+    }
+    if (!backend->zeroOut(backendOffset(offset), qMin(len, backend->size() - backendOffset(offset)))) {
+        error = backend->errorString();
+        return false;
+    }
+    return true;
+}
+
+bool SimulatedBlockDevice::flush()
+{
+    throttle(0);
+    if (!backend->flush()) {
+        error = backend->errorString();
+        return false;
+    }
+    return true;
+}
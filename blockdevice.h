@@ -0,0 +1,125 @@
+/**********************************************************************
+ *  blockdevice.h
+ **********************************************************************
+ *              Copyright (C) 2025 danko12
+ *
+ *             Author: danko12
+ *          Enhanced cross-platform USB formatting tool
+ *            Modern GUI with improved USB detection
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#pragma once
+
+#include <QElapsedTimer>
+#include <QString>
+
+#include <memory>
+
+// Byte addressed access to something that looks like a disk: a /dev node,
+// a loop device, a plain image file or a simulated device on top of one.
+class BlockDevice
+{
+public:
+    virtual ~BlockDevice() = default;
+
+    [[nodiscard]] virtual QString path() const = 0;
+    [[nodiscard]] virtual qint64 size() const = 0;
+    [[nodiscard]] virtual int sectorSize() const { return 512; }
+
+    // return the number of bytes transferred, -1 on error (see errorString())
+    [[nodiscard]] virtual qint64 read(qint64 offset, char *data, qint64 len) = 0;
+    [[nodiscard]] virtual qint64 write(qint64 offset, const char *data, qint64 len) = 0;
+
+    virtual bool discard(qint64 offset, qint64 len) = 0;
+    // make the range read back as zeros, which discard does not promise
+    virtual bool zeroOut(qint64 offset, qint64 len) = 0;
+    virtual bool flush() = 0;
+
+    [[nodiscard]] QString errorString() const { return error; }
+
+    // "sdb", "/dev/sdb", "/dev/loop0", "disk.img" or "sim:disk.img?latency=2ms,throughput=20M"
+    [[nodiscard]] static std::unique_ptr<BlockDevice> open(const QString &spec, bool writable, QString *error = nullptr);
+
+protected:
+    QString error;
+};
+
+// Real block devices and image files through pread/pwrite
+class FileBlockDevice : public BlockDevice
+{
+public:
+    FileBlockDevice(const QString &path, bool writable);
+    ~FileBlockDevice() override;
+
+    [[nodiscard]] bool isOpen() const { return fd >= 0; }
+
+    [[nodiscard]] QString path() const override { return filePath; }
+    [[nodiscard]] qint64 size() const override { return bytes; }
+    [[nodiscard]] int sectorSize() const override { return sector; }
+    [[nodiscard]] qint64 read(qint64 offset, char *data, qint64 len) override;
+    [[nodiscard]] qint64 write(qint64 offset, const char *data, qint64 len) override;
+    bool discard(qint64 offset, qint64 len) override;
+    bool zeroOut(qint64 offset, qint64 len) override;
+    bool flush() override;
+
+private:
+    QString filePath;
+    int fd = -1;
+    bool blockDevice = false;
+    qint64 bytes = 0;
+    int sector = 512;
+};
+
+// Misbehaviour injected by SimulatedBlockDevice
+struct SimulationProfile {
+    qint64 capacity = -1;      // advertised size, larger than the backend behaves like a fake stick
+    qint64 latencyUs = 0;      // added to every request
+    qint64 throughput = 0;     // bytes per second, 0 = unlimited
+    qint64 failAt = -1;        // writes touching [failAt, failAt + failLength) fail with EIO
+    qint64 failLength = 4096;
+    double errorRate = 0.0;    // probability of a random write error per request
+    bool discard = true;       // false: discard and zero-out fail like on most USB sticks
+
+    // "capacity=64G,latency=2ms,throughput=20M,fail-at=1G,fail-length=1M,error-rate=0.001,no-discard"
+    [[nodiscard]] static SimulationProfile fromString(const QString &spec, bool *ok = nullptr);
+};
+
+// Image file backed device that misbehaves like slow, failing or counterfeit
+// flash, so the pipeline can be profiled and tested without root or hardware
+class SimulatedBlockDevice : public BlockDevice
+{
+public:
+    SimulatedBlockDevice(std::unique_ptr<BlockDevice> backend, const SimulationProfile &profile);
+
+    [[nodiscard]] QString path() const override { return backend->path(); }
+    [[nodiscard]] qint64 size() const override;
+    [[nodiscard]] int sectorSize() const override { return backend->sectorSize(); }
+    [[nodiscard]] qint64 read(qint64 offset, char *data, qint64 len) override;
+    [[nodiscard]] qint64 write(qint64 offset, const char *data, qint64 len) override;
+    bool discard(qint64 offset, qint64 len) override;
+    bool zeroOut(qint64 offset, qint64 len) override;
+    bool flush() override;
+
+private:
+    std::unique_ptr<BlockDevice> backend;
+    SimulationProfile profile;
+    QElapsedTimer clock;
+    qint64 transferred = 0;
+
+    void throttle(qint64 len);
+    [[nodiscard]] bool injectWriteError(qint64 offset, qint64 len);
+    [[nodiscard]] qint64 backendOffset(qint64 offset) const;
+};
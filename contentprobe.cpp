@@ -0,0 +1,351 @@
+/**********************************************************************
+ *  contentprobe.cpp
+ **********************************************************************
+ *              Copyright (C) 2025 danko12
+ *
+ *             Author: danko12
+ *          Enhanced cross-platform USB formatting tool
+ *            Modern GUI with improved USB detection
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "contentprobe.h"
+#include "blockdevice.h"
+
+#include <QFile>
+#include <QLocale>
+#include <QSocketNotifier>
+#include <QStringList>
+
+#include <algorithm>
+#include <linux/netlink.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace
+{
+QByteArray readAt(BlockDevice &device, qint64 offset, qint64 len)
+{
+    QByteArray data(int(len), Qt::Uninitialized);
+    const qint64 n = (offset >= 0 && offset < device.size()) ? device.read(offset, data.data(), len) : -1;
+    if (n < 0) {
+        return {};
+    }
+    data.truncate(int(n));
+    return data;
+}
+
+// little-endian fields, 0 past the end of the buffer
+quint64 le(const QByteArray &data, int offset, int size)
+{
+    quint64 value = 0;
+    if (offset + size > data.size()) {
+        return 0;
+    }
+    for (int i = size - 1; i >= 0; --i) {
+        value = (value << 8) | quint8(data.at(offset + i));
+    }
+    return value;
+}
+
+bool has(const QByteArray &data, int offset, const char *text)
+{
+    return data.mid(offset, int(qstrlen(text))) == text;
+}
+
+QString text(const QByteArray &data, int offset, int size)
+{
+    QByteArray field = data.mid(offset, size);
+    const int nul = field.indexOf('\0');
+    if (nul >= 0) {
+        field.truncate(nul);
+    }
+    return QString::fromLatin1(field).trimmed();
+}
+
+QString hex(quint64 value, int digits)
+{
+    return QString("%1").arg(value, digits, 16, QChar('0')).toUpper();
+}
+
+// mixed-endian GUID (GPT) or plain byte order UUID (ext)
+QString guid(const QByteArray &data, int offset, bool mixed)
+{
+    QByteArray raw = data.mid(offset, 16);
+    if (raw.size() != 16) {
+        return {};
+    }
+    if (mixed) {
+        std::reverse(raw.begin(), raw.begin() + 4);
+        std::reverse(raw.begin() + 4, raw.begin() + 6);
+        std::reverse(raw.begin() + 6, raw.begin() + 8);
+    }
+    const QByteArray h = raw.toHex();
+    return QString::fromLatin1(h.left(8) + '-' + h.mid(8, 4) + '-' + h.mid(12, 4) + '-' + h.mid(16, 4) + '-' + h.mid(20));
+}
+}
+
+QString DeviceContents::summary() const
+{
+    if (!known) {
+        return QObject::tr("unknown");
+    }
+    QStringList parts;
+    if (!table.isEmpty()) {
+        parts << table;
+    }
+    if (!fstype.isEmpty()) {
+        QString fs = fstype;
+        if (!label.isEmpty()) {
+            fs += QString(" \"%1\"").arg(label);
+        }
+        if (used >= 0) {
+            fs += " " + QObject::tr("%1 used").arg(QLocale().formattedDataSize(used, 1, QLocale::DataSizeTraditionalFormat));
+        }
+        parts << fs;
+    }
+    return parts.isEmpty() ? QObject::tr("empty") : parts.join(", ");
+}
+
+ContentProbe::ContentProbe(QObject *parent)
+    : QObject(parent)
+{
+    // kernel (1) and udev (2) uevents; udev ones arrive after its database is updated
+    uevents = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_KOBJECT_UEVENT);
+    sockaddr_nl addr {};
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = 1 | 2;
+    if (uevents >= 0 && bind(uevents, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0) {
+        notifier = new QSocketNotifier(uevents, QSocketNotifier::Read, this);
+        connect(notifier, &QSocketNotifier::activated, this, &ContentProbe::readUevents);
+    } else if (uevents >= 0) {
+        ::close(uevents);
+        uevents = -1;
+    }
+}
+
+ContentProbe::~ContentProbe()
+{
+    if (uevents >= 0) {
+        ::close(uevents);
+    }
+}
+
+DeviceContents ContentProbe::contents(const QString &name)
+{
+    // without uevents (or for image files) a cached entry could never be invalidated
+    if (!notifier || name.contains('/')) {
+        return probe(name);
+    }
+    auto it = cache.constFind(name);
+    if (it == cache.constEnd()) {
+        it = cache.insert(name, probe(name));
+    }
+    return it.value();
+}
+
+DeviceContents ContentProbe::probe(const QString &name)
+{
+    DeviceContents contents;
+    const auto device = BlockDevice::open(name, false);
+    if (!device) {
+        // typically EACCES: block devices belong to root:disk
+        probeUdev(name, contents);
+        return contents;
+    }
+
+    const QByteArray head = readAt(*device, 0, 4096);
+    if (head.size() < 512) {
+        probeUdev(name, contents);
+        return contents;
+    }
+    contents.known = true;
+    if (!probeFilesystem(*device, head, contents)) {
+        probeTable(*device, head, contents);
+    }
+    // labels of exFAT and NTFS live in the root directory and the MFT
+    if (contents.label.isEmpty() && !contents.fstype.isEmpty() && !name.contains('/')) {
+        DeviceContents udev;
+        probeUdev(name, udev);
+        if (udev.fstype == contents.fstype) {
+            contents.label = udev.label;
+        }
+    }
+    return contents;
+}
+
+bool ContentProbe::probeFilesystem(BlockDevice &device, const QByteArray &head, DeviceContents &contents)
+{
+    const QByteArray iso = readAt(device, 32768, 2048);
+    if (has(iso, 1, "CD001")) {
+        contents.fstype = "iso9660";
+        contents.label = text(iso, 40, 32);
+        return true;
+    }
+
+    const bool bootSignature = le(head, 510, 2) == 0xAA55;
+    if (bootSignature && has(head, 3, "EXFAT   ")) {
+        const quint64 clusters = le(head, 92, 4);
+        const int clusterShift = int(le(head, 108, 1) + le(head, 109, 1));
+        const quint64 percent = le(head, 112, 1); // 0xff when not computed
+        contents.fstype = "exfat";
+        contents.uuid = hex(le(head, 100, 4) >> 16, 4) + '-' + hex(le(head, 100, 2), 4);
+        if (percent <= 100 && clusterShift < 40) {
+            contents.used = qint64((clusters << clusterShift) / 100 * percent);
+        }
+        return true;
+    }
+    if (bootSignature && has(head, 3, "NTFS    ")) {
+        contents.fstype = "ntfs";
+        contents.uuid = hex(le(head, 0x48, 8), 16);
+        return true;
+    }
+    if (bootSignature && (has(head, 82, "FAT32   ") || has(head, 54, "FAT1"))) {
+        const bool fat32 = has(head, 82, "FAT32   ");
+        const int idOffset = fat32 ? 67 : 39;
+        contents.fstype = "vfat";
+        contents.uuid = hex(le(head, idOffset + 2, 2), 4) + '-' + hex(le(head, idOffset, 2), 4);
+        contents.label = text(head, idOffset + 4, 11);
+        if (contents.label == "NO NAME") {
+            contents.label.clear();
+        }
+
+        // FAT32 keeps a free cluster count in the FSInfo sector
+        const quint64 sectorBytes = le(head, 11, 2);
+        const quint64 clusterSectors = le(head, 13, 1);
+        const quint64 fsinfo = le(head, 48, 2);
+        if (fat32 && sectorBytes >= 512 && clusterSectors > 0 && fsinfo > 0) {
+            const quint64 sectors = le(head, 19, 2) ? le(head, 19, 2) : le(head, 32, 4);
+            const quint64 dataStart = le(head, 14, 2) + le(head, 16, 1) * le(head, 36, 4);
+            const quint64 clusters = sectors > dataStart ? (sectors - dataStart) / clusterSectors : 0;
+            const QByteArray info = readAt(device, qint64(fsinfo * sectorBytes), 512);
+            const quint64 free = le(info, 488, 4);
+            if (le(info, 0, 4) == 0x41615252 && le(info, 484, 4) == 0x61417272 && free <= clusters) {
+                contents.used = qint64((clusters - free) * clusterSectors * sectorBytes);
+            }
+        }
+        return true;
+    }
+
+    // ext2/3/4 superblock at 1024
+    if (le(head, 1024 + 56, 2) == 0xEF53) {
+        const quint64 compat = le(head, 1024 + 0x5C, 4);
+        const quint64 incompat = le(head, 1024 + 0x60, 4);
+        const bool is64 = incompat & 0x80;
+        const quint64 blocks = le(head, 1024 + 4, 4) | (is64 ? le(head, 1024 + 0x150, 4) << 32 : 0);
+        const quint64 free = le(head, 1024 + 12, 4) | (is64 ? le(head, 1024 + 0x158, 4) << 32 : 0);
+        const quint64 logBlock = le(head, 1024 + 24, 4);
+        contents.fstype = (incompat & (0x40 | 0x80 | 0x200)) ? "ext4" : (compat & 0x4) ? "ext3" : "ext2";
+        contents.label = text(head, 1024 + 0x78, 16);
+        contents.uuid = guid(head, 1024 + 0x68, false);
+        if (logBlock < 16 && free <= blocks) {
+            contents.used = qint64((blocks - free) << (10 + logBlock));
+        }
+        return true;
+    }
+    return false;
+}
+
+void ContentProbe::probeTable(BlockDevice &device, const QByteArray &head, DeviceContents &contents)
+{
+    const qint64 sector = device.sectorSize();
+    const qint64 lastLba = device.size() / sector - 1;
+    if (le(head, 510, 2) != 0xAA55) {
+        return;
+    }
+
+    bool protective = false;
+    for (int entry = 0; entry < 4; ++entry) {
+        protective |= quint8(head.at(446 + 16 * entry + 4)) == 0xEE;
+    }
+    if (!protective) {
+        contents.table = "dos";
+        contents.uuid = QString("%1").arg(le(head, 440, 4), 8, 16, QChar('0'));
+        return;
+    }
+
+    // primary header at LBA 1, the backup one where the primary says, normally the last LBA
+    const QByteArray primary = readAt(device, sector, 92);
+    const bool primaryOk = has(primary, 0, "EFI PART");
+    const qint64 backupLba = primaryOk ? qint64(le(primary, 32, 8)) : lastLba;
+    const QByteArray backup = readAt(device, backupLba * sector, 92);
+    const bool backupOk = has(backup, 0, "EFI PART");
+
+    contents.table = "gpt";
+    if (primaryOk && !backupOk) {
+        contents.table = QObject::tr("gpt, backup header missing");
+    } else if (!primaryOk && backupOk) {
+        contents.table = QObject::tr("gpt, primary header damaged");
+    } else if (!primaryOk) {
+        contents.table = QObject::tr("gpt, both headers damaged");
+    }
+    contents.uuid = guid(primaryOk ? primary : backup, 56, true);
+}
+
+void ContentProbe::probeUdev(const QString &name, DeviceContents &contents)
+{
+    QFile dev("/sys/class/block/" + name + "/dev");
+    if (name.contains('/') || !dev.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    QFile data("/run/udev/data/b" + QString::fromLatin1(dev.readAll().trimmed()));
+    if (!data.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    contents.known = true;
+    contents.fromUdev = true;
+    for (const QByteArray &line : data.readAll().split('\n')) {
+        if (line.startsWith("E:ID_FS_TYPE=")) {
+            contents.fstype = QString::fromUtf8(line.mid(13));
+        } else if (line.startsWith("E:ID_FS_LABEL=")) {
+            contents.label = QString::fromUtf8(line.mid(14));
+        } else if (line.startsWith("E:ID_FS_UUID=")) {
+            contents.uuid = QString::fromUtf8(line.mid(13));
+        } else if (line.startsWith("E:ID_PART_TABLE_TYPE=")) {
+            contents.table = QString::fromUtf8(line.mid(21));
+        }
+    }
+}
+
+void ContentProbe::readUevents()
+{
+    char buffer[8192];
+    ssize_t n;
+    while ((n = recv(uevents, buffer, sizeof(buffer), 0)) > 0) {
+        // NUL separated KEY=VALUE, after a binary header for udev messages
+        QString name;
+        bool block = false;
+        for (const QByteArray &field : QByteArray(buffer, int(n)).split('\0')) {
+            if (field == "SUBSYSTEM=block") {
+                block = true;
+            } else if (field.startsWith("DEVNAME=")) {
+                name = QString::fromUtf8(field.mid(8)).remove("/dev/");
+            }
+        }
+        if (!block || name.isEmpty()) {
+            continue;
+        }
+        // a disk event may stand for a new partition table, forget its partitions too
+        for (auto it = cache.begin(); it != cache.end();) {
+            if (it.key().startsWith(name)) {
+                it = cache.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        emit changed(name);
+    }
+}
@@ -0,0 +1,73 @@
+/**********************************************************************
+ *  contentprobe.h
+ **********************************************************************
+ *              Copyright (C) 2025 danko12
+ *
+ *             Author: danko12
+ *          Enhanced cross-platform USB formatting tool
+ *            Modern GUI with improved USB detection
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QString>
+
+class BlockDevice;
+class QSocketNotifier;
+
+// What a disk or partition holds, as far as its first sectors tell
+struct DeviceContents {
+    QString table;  // dos or gpt, with a note if a GPT header is damaged
+    QString fstype; // vfat, exfat, ntfs, ext2/3/4, iso9660
+    QString label;
+    QString uuid;   // filesystem UUID or serial, disk identifier for tables
+    qint64 used = -1; // bytes, -1 if the filesystem does not record it
+    bool known = false; // false if the device could not be read at all
+    bool fromUdev = false; // described by the udev database, which has no used space
+
+    [[nodiscard]] QString summary() const;
+};
+
+// Reads the partition table and filesystem superblocks in process, a few KiB
+// per device instead of a blkid fork. Devices the user may not open are
+// described from the udev database instead. Results are cached until a
+// uevent reports the device changed.
+class ContentProbe : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ContentProbe(QObject *parent = nullptr);
+    ~ContentProbe() override;
+
+    [[nodiscard]] DeviceContents contents(const QString &name);
+
+    [[nodiscard]] static DeviceContents probe(const QString &name);
+
+signals:
+    void changed(const QString &name);
+
+private:
+    QHash<QString, DeviceContents> cache;
+    int uevents = -1;
+    QSocketNotifier *notifier = nullptr;
+
+    void readUevents();
+    static bool probeFilesystem(BlockDevice &device, const QByteArray &head, DeviceContents &contents);
+    static void probeTable(BlockDevice &device, const QByteArray &head, DeviceContents &contents);
+    static void probeUdev(const QString &name, DeviceContents &contents);
+};
@@ -0,0 +1,161 @@
+/**********************************************************************
+ *  devicemodel.cpp
+ **********************************************************************
+ *              Copyright (C) 2025 danko12
+ *
+ *             Author: danko12
+ *          Enhanced cross-platform USB formatting tool
+ *            Modern GUI with improved USB detection
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "devicemodel.h"
+
+#include <QLocale>
+#include <QSet>
+#include <QStringList>
+
+QString DeviceInfo::vendorModel() const
+{
+    return QStringList({vendor, model}).join(" ").simplified();
+}
+
+QString DeviceInfo::sizeText() const
+{
+    return QLocale().formattedDataSize(size, 1, QLocale::DataSizeTraditionalFormat);
+}
+
+QString DeviceInfo::summary() const
+{
+    QString info = QString("%1 (%2)").arg(name, sizeText());
+    if (!vendorModel().isEmpty()) {
+        info += " " + vendorModel();
+    }
+    if (partition && !label.isEmpty()) {
+        info += " " + label;
+    }
+    return info;
+}
+
+DeviceModel::DeviceModel(QObject *parent)
+    : QAbstractTableModel(parent)
+{
+}
+
+int DeviceModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : devices.size();
+}
+
+int DeviceModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant DeviceModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= devices.size()) {
+        return {};
+    }
+    const DeviceInfo &dev = devices.at(index.row());
+
+    if (role == Qt::ToolTipRole) {
+        if (index.column() == Contents && !dev.uuid.isEmpty()) {
+            return tr("UUID: %1").arg(dev.uuid);
+        }
+        return dev.summary();
+    }
+    if (role == SortRole && index.column() == Size) {
+        return dev.size;
+    }
+    if (role != Qt::DisplayRole && role != SortRole) {
+        return {};
+    }
+
+    switch (index.column()) {
+    case Name:        return dev.name;
+    case Size:        return dev.sizeText();
+    case VendorModel: return dev.vendorModel();
+    case Serial:      return dev.serial;
+    case BusPath:     return dev.busPath;
+    case Mounted:     return dev.mountpoint;
+    case Filesystem:  return dev.label.isEmpty() ? dev.fstype : QString("%1 (%2)").arg(dev.fstype, dev.label);
+    case Contents:    return dev.contents;
+    default:          return {};
+    }
+}
+
+QVariant DeviceModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return QAbstractTableModel::headerData(section, orientation, role);
+    }
+
+    switch (section) {
+    case Name:        return tr("Device");
+    case Size:        return tr("Size");
+    case VendorModel: return tr("Vendor/Model");
+    case Serial:      return tr("Serial");
+    case BusPath:     return tr("Port");
+    case Mounted:     return tr("Mounted");
+    case Filesystem:  return tr("Filesystem");
+    case Contents:    return tr("Contents");
+    default:          return {};
+    }
+}
+
+void DeviceModel::setDevices(const QList<DeviceInfo> &fresh)
+{
+    QSet<QString> freshNames;
+    for (const DeviceInfo &dev : fresh) {
+        freshNames.insert(dev.name);
+    }
+
+    // drop devices that disappeared, from the back so row numbers stay valid
+    for (int row = devices.size() - 1; row >= 0; --row) {
+        if (!freshNames.contains(devices.at(row).name)) {
+            beginRemoveRows(QModelIndex(), row, row);
+            devices.removeAt(row);
+            endRemoveRows();
+        }
+    }
+
+    for (const DeviceInfo &dev : fresh) {
+        const int row = rowOf(dev.name);
+        if (row < 0) {
+            beginInsertRows(QModelIndex(), devices.size(), devices.size());
+            devices.append(dev);
+            endInsertRows();
+        } else if (!(devices.at(row) == dev)) {
+            devices[row] = dev;
+            emit dataChanged(index(row, 0), index(row, ColumnCount - 1));
+        }
+    }
+}
+
+const DeviceInfo &DeviceModel::device(int row) const
+{
+    return devices.at(row);
+}
+
+int DeviceModel::rowOf(const QString &name) const
+{
+    for (int row = 0; row < devices.size(); ++row) {
+        if (devices.at(row).name == name) {
+            return row;
+        }
+    }
+    return -1;
+}
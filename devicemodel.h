@@ -0,0 +1,80 @@
+/**********************************************************************
+ *  devicemodel.h
+ **********************************************************************
+ *              Copyright (C) 2025 danko12
+ *
+ *             Author: danko12
+ *          Enhanced cross-platform USB formatting tool
+ *            Modern GUI with improved USB detection
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#pragma once
+
+#include <QAbstractTableModel>
+#include <QList>
+#include <QString>
+
+// One disk or partition as shown in the device list
+struct DeviceInfo {
+    QString name;       // kernel name, e.g. sdb or sdb1
+    QString parent;     // parent disk for partitions
+    qint64 size = 0;    // bytes
+    QString vendor;
+    QString model;
+    QString serial;
+    QString busPath;    // usb-2-1.4 or pci-0000:00:1d.0
+    QString mountpoint; // first mountpoint of the device or one of its partitions
+    QString fstype;
+    QString label;
+    QString contents;   // partition table and filesystems found on the device
+    QString uuid;
+    bool partition = false;
+    bool usb = false;
+
+    bool operator==(const DeviceInfo &other) const = default;
+
+    [[nodiscard]] QString vendorModel() const;
+    [[nodiscard]] QString sizeText() const;
+    [[nodiscard]] QString summary() const; // one line description for dialogs and logs
+};
+
+class DeviceModel : public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    enum Column { Name, Size, VendorModel, Serial, BusPath, Mounted, Filesystem, Contents, ColumnCount };
+
+    // Raw value used by the proxy for sorting (size in bytes instead of "14.9 GB")
+    static constexpr int SortRole = Qt::UserRole;
+
+    explicit DeviceModel(QObject *parent = nullptr);
+
+    [[nodiscard]] int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    [[nodiscard]] int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    [[nodiscard]] QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    [[nodiscard]] QVariant headerData(int section, Qt::Orientation orientation,
+                                      int role = Qt::DisplayRole) const override;
+
+    // Merge a fresh enumeration into the model: rows are removed, updated or
+    // appended individually so views keep their selection and scroll position
+    void setDevices(const QList<DeviceInfo> &devices);
+
+    [[nodiscard]] const DeviceInfo &device(int row) const;
+    [[nodiscard]] int rowOf(const QString &name) const;
+
+private:
+    QList<DeviceInfo> devices;
+};
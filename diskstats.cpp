@@ -0,0 +1,53 @@
+/**********************************************************************
+ *  diskstats.cpp
+ **********************************************************************
+ *              Copyright (C) 2025 danko12
+ *
+ *             Author: danko12
+ *          Enhanced cross-platform USB formatting tool
+ *            Modern GUI with improved USB detection
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "diskstats.h"
+
+#include <cstdio>
+
+bool DiskStats::read(const QString &name, DiskStats &stats)
+{
+    // plain stdio: this runs for every sample of every monitored device
+    const QByteArray path = "/sys/class/block/" + name.toLocal8Bit() + "/stat";
+    FILE *file = fopen(path.constData(), "re");
+    if (!file) {
+        return false;
+    }
+
+    unsigned long long field[11] = {};
+    const int count = fscanf(file, "%llu %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu",
+                             &field[0], &field[1], &field[2], &field[3], &field[4], &field[5],
+                             &field[6], &field[7], &field[8], &field[9], &field[10]);
+    fclose(file);
+    if (count < 11) {
+        return false;
+    }
+
+    stats.reads = field[0];
+    stats.readSectors = field[2];
+    stats.writes = field[4];
+    stats.writeSectors = field[6];
+    stats.inflight = field[8];
+    stats.ioTicks = field[9];
+    return true;
+}
@@ -0,0 +1,43 @@
+/**********************************************************************
+ *  diskstats.h
+ **********************************************************************
+ *              Copyright (C) 2025 danko12
+ *
+ *             Author: danko12
+ *          Enhanced cross-platform USB formatting tool
+ *            Modern GUI with improved USB detection
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#pragma once
+
+#include <QString>
+
+// Counters from /sys/class/block/<name>/stat (see Documentation/block/stat.rst)
+struct DiskStats {
+    quint64 reads = 0;
+    quint64 readSectors = 0;
+    quint64 writes = 0;
+    quint64 writeSectors = 0;
+    quint64 inflight = 0;
+    quint64 ioTicks = 0; // ms the device had I/O in flight
+
+    // sectors in this file are always 512 bytes, whatever the device uses
+    [[nodiscard]] quint64 bytesRead() const { return readSectors * 512; }
+    [[nodiscard]] quint64 bytesWritten() const { return writeSectors * 512; }
+
+    // false if the device is gone
+    [[nodiscard]] static bool read(const QString &name, DiskStats &stats);
+};
@@ -0,0 +1,189 @@
+/**********************************************************************
+ *  drivetopology.cpp
+ **********************************************************************
+ *              Copyright (C) 2025 danko12
+ *
+ *             Author: danko12
+ *          Enhanced cross-platform USB formatting tool
+ *            Modern GUI with improved USB detection
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "drivetopology.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QSocketNotifier>
+#include <QStringList>
+
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+
+namespace
+{
+QByteArray readProcFile(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return {};
+    }
+    return file.readAll();
+}
+
+// mountinfo escapes blanks in paths as octal (\040)
+QString unescape(const QByteArray &field)
+{
+    QByteArray out;
+    for (int i = 0; i < field.size(); ++i) {
+        if (field.at(i) == '\\' && i + 3 < field.size()) {
+            out.append(char(field.mid(i + 1, 3).toInt(nullptr, 8)));
+            i += 3;
+        } else {
+            out.append(field.at(i));
+        }
+    }
+    return QString::fromUtf8(out);
+}
+}
+
+DriveTopology::DriveTopology(QObject *parent)
+    : QObject(parent),
+      mountinfo("/proc/self/mountinfo")
+{
+    // the kernel flags mount table changes as POLLPRI on an open mountinfo
+    if (mountinfo.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+        notifier = new QSocketNotifier(mountinfo.handle(), QSocketNotifier::Exception, this);
+        connect(notifier, &QSocketNotifier::activated, this, &DriveTopology::update);
+    }
+    update();
+}
+
+bool DriveTopology::isCritical(const QString &name) const
+{
+    return critical.contains(name);
+}
+
+void DriveTopology::update()
+{
+    QByteArray mounts;
+    if (mountinfo.isOpen() && mountinfo.seek(0)) {
+        mounts = mountinfo.readAll();
+    } else {
+        mounts = readProcFile("/proc/self/mountinfo");
+    }
+    QByteArray swaps = readProcFile("/proc/swaps");
+
+    if (mounts == mountinfoSnapshot && swaps == swapsSnapshot) {
+        return;
+    }
+    mountinfoSnapshot = mounts;
+    swapsSnapshot = swaps;
+    rebuild();
+    emit changed();
+}
+
+void DriveTopology::rebuild()
+{
+    critical.clear();
+
+    // mountinfo: id parent major:minor root mountpoint options ... - fstype source superoptions
+    for (const QByteArray &line : mountinfoSnapshot.split('\n')) {
+        const QList<QByteArray> fields = line.split(' ');
+        const int separator = fields.indexOf("-", 6);
+        if (separator < 0 || separator + 2 >= fields.size()) {
+            continue;
+        }
+        if (!isCriticalMountpoint(unescape(fields.at(4)))) {
+            continue;
+        }
+        // btrfs and friends report an anonymous device number, fall back to the mount source
+        QString name = nameOfDevice(QString::fromLatin1(fields.at(2)));
+        if (name.isEmpty()) {
+            name = nameOfPath(unescape(fields.at(separator + 2)));
+        }
+        markCritical(name);
+    }
+
+    // /proc/swaps: header, then "filename type size used priority"
+    const QList<QByteArray> swapLines = swapsSnapshot.split('\n');
+    for (int i = 1; i < swapLines.size(); ++i) {
+        const QList<QByteArray> fields = swapLines.at(i).simplified().split(' ');
+        if (fields.first().isEmpty()) {
+            continue;
+        }
+        const QString path = unescape(fields.first());
+        markCritical(path.startsWith("/dev/") ? nameOfPath(path) : nameOfFileDevice(path));
+    }
+
+    qDebug() << "Protected block devices:" << QStringList(critical.values()).join(" ");
+}
+
+// add a device and everything it is built on: its disk, dm/md slaves and loop backing files
+void DriveTopology::markCritical(const QString &name)
+{
+    if (name.isEmpty() || critical.contains(name)) {
+        return;
+    }
+    critical.insert(name);
+
+    const QString sysPath = "/sys/class/block/" + name;
+    if (QFile::exists(sysPath + "/partition")) {
+        markCritical(QFileInfo(QFileInfo(sysPath).canonicalFilePath()).dir().dirName());
+    }
+
+    const QStringList slaves = QDir(sysPath + "/slaves").entryList(QDir::AllEntries | QDir::NoDotAndDotDot);
+    for (const QString &slave : slaves) {
+        markCritical(slave);
+    }
+
+    QFile backing(sysPath + "/loop/backing_file");
+    if (backing.open(QIODevice::ReadOnly)) {
+        markCritical(nameOfFileDevice(QString::fromUtf8(backing.readAll().trimmed())));
+    }
+}
+
+// "8:2" -> "sda2", empty for anonymous devices (tmpfs, btrfs subvolumes, ...)
+QString DriveTopology::nameOfDevice(const QString &majorMinor)
+{
+    const QFileInfo link("/sys/dev/block/" + majorMinor);
+    return link.exists() ? QFileInfo(link.canonicalFilePath()).fileName() : QString();
+}
+
+// "/dev/mapper/root" -> "dm-0"
+QString DriveTopology::nameOfPath(const QString &path)
+{
+    if (!path.startsWith("/dev/")) {
+        return {};
+    }
+    const QString name = QFileInfo(QFileInfo(path).canonicalFilePath()).fileName();
+    return QFile::exists("/sys/class/block/" + name) ? name : QString();
+}
+
+// block device holding a regular file (swap files, loop backing files)
+QString DriveTopology::nameOfFileDevice(const QString &path)
+{
+    struct stat st {};
+    if (path.isEmpty() || ::stat(path.toLocal8Bit().constData(), &st) != 0) {
+        return {};
+    }
+    return nameOfDevice(QString("%1:%2").arg(major(st.st_dev)).arg(minor(st.st_dev)));
+}
+
+bool DriveTopology::isCriticalMountpoint(const QString &mountpoint)
+{
+    static const QSet<QString> system {"/", "/boot", "/usr", "/var", "/home", "/opt", "/srv"};
+    return system.contains(mountpoint) || mountpoint.startsWith("/boot/");
+}
@@ -0,0 +1,66 @@
+/**********************************************************************
+ *  drivetopology.h
+ **********************************************************************
+ *              Copyright (C) 2025 danko12
+ *
+ *             Author: danko12
+ *          Enhanced cross-platform USB formatting tool
+ *            Modern GUI with improved USB detection
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#pragma once
+
+#include <QByteArray>
+#include <QFile>
+#include <QObject>
+#include <QSet>
+#include <QString>
+
+class QSocketNotifier;
+
+// Index of block devices that back a critical mount or active swap, directly
+// or through partitions, LVM, dm-crypt, md RAID or loop devices.
+// Built from /proc/self/mountinfo, /proc/swaps and the sysfs slaves links;
+// rebuilt only when the kernel reports a mount table change or swap changes.
+class DriveTopology : public QObject
+{
+    Q_OBJECT
+public:
+    explicit DriveTopology(QObject *parent = nullptr);
+
+    // true if formatting this disk or partition would destroy a system mount
+    [[nodiscard]] bool isCritical(const QString &name) const;
+
+    // re-read mountinfo and swaps, rebuild the index if anything changed
+    void update();
+
+signals:
+    void changed();
+
+private:
+    QFile mountinfo; // kept open so the kernel can signal changes through poll
+    QSocketNotifier *notifier = nullptr;
+    QByteArray mountinfoSnapshot;
+    QByteArray swapsSnapshot;
+    QSet<QString> critical;
+
+    void rebuild();
+    void markCritical(const QString &name);
+    [[nodiscard]] static QString nameOfDevice(const QString &majorMinor);
+    [[nodiscard]] static QString nameOfPath(const QString &path);
+    [[nodiscard]] static QString nameOfFileDevice(const QString &path);
+    [[nodiscard]] static bool isCriticalMountpoint(const QString &mountpoint);
+};
@@ -0,0 +1,164 @@
+/**********************************************************************
+ *  goldentemplate.cpp
+ **********************************************************************
+ *              Copyright (C) 2025 danko12
+ *
+ *             Author: danko12
+ *          Enhanced cross-platform USB formatting tool
+ *            Modern GUI with improved USB detection
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "goldentemplate.h"
+#include "blockdevice.h"
+
+#include <QByteArray>
+#include <QTextStream>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace
+{
+constexpr qint64 CopyChunk = 4 * 1024 * 1024;
+}
+
+QList<GoldenTemplate::Range> GoldenTemplate::dataRanges(const QString &image, QString *error)
+{
+    QList<Range> ranges;
+    const int fd = ::open(image.toLocal8Bit().constData(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (error) {
+            *error = QString("%1: %2").arg(image, QString::fromLocal8Bit(strerror(errno)));
+        }
+        return ranges;
+    }
+
+    const off_t end = lseek(fd, 0, SEEK_END);
+    off_t data = lseek(fd, 0, SEEK_DATA);
+    while (data >= 0 && data < end) {
+        off_t hole = lseek(fd, data, SEEK_HOLE);
+        if (hole < 0) {
+            hole = end;
+        }
+        ranges << Range {qint64(data), qint64(hole - data)};
+        data = lseek(fd, hole, SEEK_DATA); // ENXIO past the last extent
+    }
+    ::close(fd);
+    return ranges;
+}
+
+bool GoldenTemplate::stamp(const QString &image, const QString &device, QString *error)
+{
+    QTextStream out(stdout);
+    QString message;
+    const auto source = BlockDevice::open(image, false, &message);
+    const auto target = source ? BlockDevice::open(device, true, &message) : nullptr;
+    auto fail = [error](const QString &reason) {
+        if (error) {
+            *error = reason;
+        }
+        return false;
+    };
+
+    if (!source || !target) {
+        return fail(message);
+    }
+    if (source->size() != target->size()) {
+        return fail(QString("template is %1 bytes, %2 is %3 bytes").arg(source->size()).arg(device).arg(target->size()));
+    }
+
+    const QList<Range> ranges = dataRanges(image, &message);
+    if (ranges.isEmpty()) {
+        return fail(message.isEmpty() ? QString("template %1 is empty").arg(image) : message);
+    }
+    qint64 total = 0;
+    for (const Range &range : ranges) {
+        total += range.length;
+    }
+    out << QString("stamping %1 extents, %2 MiB of %3 MiB\n")
+               .arg(ranges.size()).arg(total >> 20).arg(target->size() >> 20);
+    out.flush();
+
+    QByteArray buffer(int(CopyChunk), Qt::Uninitialized);
+
+    // everything between the extents must read back as zeros like after a fresh
+    // format: mke2fs zeroes its journal with write-zeroes, which a loop device
+    // turns into unwritten extents that SEEK_DATA reports as holes
+    const QByteArray zeros(int(CopyChunk), '\0');
+    qint64 gapStart = 0;
+    bool offload = true; // BLKZEROOUT or a punched hole, until the target refuses
+    auto zeroGap = [&](qint64 end) {
+        if (offload && end > gapStart && !target->zeroOut(gapStart, end - gapStart)) {
+            out << QString("%1, writing zeros between the extents\n").arg(target->errorString());
+            out.flush();
+            offload = false;
+        }
+        for (qint64 offset = gapStart; !offload && offset < end; offset += CopyChunk) {
+            const qint64 len = qMin(CopyChunk, end - offset);
+            if (target->write(offset, zeros.constData(), len) != len) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    qint64 done = 0;
+    for (const Range &range : ranges) {
+        if (!zeroGap(range.offset)) {
+            return fail(target->errorString());
+        }
+        gapStart = range.offset + range.length;
+        for (qint64 offset = range.offset; offset < range.offset + range.length; offset += CopyChunk) {
+            const qint64 len = qMin(CopyChunk, range.offset + range.length - offset);
+            if (source->read(offset, buffer.data(), len) != len) {
+                return fail(source->errorString());
+            }
+            if (target->write(offset, buffer.constData(), len) != len) {
+                return fail(target->errorString());
+            }
+            done += len;
+        }
+        out << QString("stamped %1 of %2 MiB\n").arg(done >> 20).arg(total >> 20);
+        out.flush();
+    }
+    if (!zeroGap(target->size())) {
+        return fail(target->errorString());
+    }
+
+    if (!target->flush()) {
+        return fail(target->errorString());
+    }
+    return true;
+}
+
+int GoldenTemplate::runCommand(const QStringList &args)
+{
+    QTextStream err(stderr);
+    if (args.size() != 2) {
+        err << "Usage: formatusb --stamp-template <image> <device>\n";
+        return EXIT_FAILURE;
+    }
+
+    QString error;
+    if (!stamp(args.at(0), args.at(1), &error)) {
+        err << "stamp template: " << error << "\n";
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
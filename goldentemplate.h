@@ -0,0 +1,49 @@
+/**********************************************************************
+ *  goldentemplate.h
+ **********************************************************************
+ *              Copyright (C) 2025 danko12
+ *
+ *             Author: danko12
+ *          Enhanced cross-platform USB formatting tool
+ *            Modern GUI with improved USB detection
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#pragma once
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+// A golden template is a sparse image the full pipeline was run on once.
+// Its allocated extents are exactly the blocks the pipeline wrote (zeros
+// included); blocks it discarded, zeroed or never touched are holes. Stamping
+// writes those extents onto an identical device and zeroes everything else.
+class GoldenTemplate
+{
+public:
+    struct Range {
+        qint64 offset = 0;
+        qint64 length = 0;
+    };
+
+    // allocated extents of the image, found with SEEK_DATA/SEEK_HOLE
+    [[nodiscard]] static QList<Range> dataRanges(const QString &image, QString *error = nullptr);
+
+    [[nodiscard]] static bool stamp(const QString &image, const QString &device, QString *error = nullptr);
+
+    // formatusb --stamp-template <image> <device>, run by formatusb_lib as root
+    static int runCommand(const QStringList &args);
+};
@@ -8,7 +8,12 @@ sudo chmod 755 /usr/local/bin/formatusb
 sudo mkdir -p /usr/local/lib/formatusb/
 sudo cp lib/formatusb_lib /usr/local/lib/formatusb/
 sudo chmod 755 /usr/local/lib/formatusb/formatusb_lib
+sudo cp lib/formatusb_restore /usr/local/lib/formatusb/
+sudo chmod 755 /usr/local/lib/formatusb/formatusb_restore
 
+# 2b. Copy partition layout presets
+sudo mkdir -p /usr/local/share/formatusb/layouts/
+sudo cp layouts/*.layout /usr/local/share/formatusb/layouts/
 
 # 3. Copy icon
 sudo mkdir -p /usr/share/icons/hicolor/scalable/apps/
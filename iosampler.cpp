@@ -0,0 +1,120 @@
+/**********************************************************************
+ *  iosampler.cpp
+ **********************************************************************
+ *              Copyright (C) 2025 danko12
+ *
+ *             Author: danko12
+ *          Enhanced cross-platform USB formatting tool
+ *            Modern GUI with improved USB detection
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "iosampler.h"
+
+StallPolicy StallPolicy::fromArguments(const QStringList &args)
+{
+    StallPolicy policy;
+    bool ok = false;
+
+    const int seconds = qEnvironmentVariable("FORMATUSB_STALL_TIMEOUT").toInt(&ok);
+    if (ok) {
+        policy.seconds = seconds;
+    }
+    policy.abort = qEnvironmentVariable("FORMATUSB_ABORT_ON_STALL") == "1";
+
+    const int arg = args.indexOf("--stall-timeout");
+    if (arg >= 0 && arg + 1 < args.size()) {
+        const int value = args.at(arg + 1).toInt(&ok);
+        if (ok) {
+            policy.seconds = value;
+        }
+    }
+    if (args.contains("--abort-on-stall")) {
+        policy.abort = true;
+    }
+    return policy;
+}
+
+IoSampler::IoSampler(QObject *parent, int intervalMs)
+    : QObject(parent)
+{
+    timer.setInterval(intervalMs);
+    connect(&timer, &QTimer::timeout, this, &IoSampler::sample);
+    clock.start();
+}
+
+void IoSampler::watch(const QString &name)
+{
+    Device device;
+    if (!DiskStats::read(name, device.last)) {
+        return;
+    }
+    device.sampledAt = device.progressAt = clock.elapsed();
+    devices.insert(name, device);
+    if (!timer.isActive()) {
+        timer.start();
+    }
+}
+
+void IoSampler::unwatch(const QString &name)
+{
+    devices.remove(name);
+    if (devices.isEmpty()) {
+        timer.stop();
+    }
+}
+
+void IoSampler::sample()
+{
+    const qint64 now = clock.elapsed();
+
+    for (auto it = devices.begin(); it != devices.end();) {
+        DiskStats stats;
+        if (!DiskStats::read(it.key(), stats)) {
+            it = devices.erase(it); // unplugged
+            continue;
+        }
+
+        Device &device = it.value();
+        const double seconds = qMax<qint64>(now - device.sampledAt, 1) / 1000.0;
+        const quint64 completed = (stats.reads - device.last.reads) + (stats.writes - device.last.writes);
+
+        IoRate rate;
+        rate.readBytesPerSecond = double(stats.bytesRead() - device.last.bytesRead()) / seconds;
+        rate.writeBytesPerSecond = double(stats.bytesWritten() - device.last.bytesWritten()) / seconds;
+        rate.iops = double(completed) / seconds;
+        rate.inflight = stats.inflight;
+
+        device.last = stats;
+        device.sampledAt = now;
+        if (completed > 0 || stats.inflight == 0) {
+            device.progressAt = now;
+            if (device.stalled) {
+                device.stalled = false;
+                emit recovered(it.key());
+            }
+        } else if (stallMs > 0 && !device.stalled && now - device.progressAt >= stallMs) {
+            device.stalled = true;
+            emit stalled(it.key(), now - device.progressAt, stats.inflight);
+        }
+
+        emit sampled(it.key(), rate);
+        ++it;
+    }
+
+    if (devices.isEmpty()) {
+        timer.stop();
+    }
+}
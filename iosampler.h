@@ -0,0 +1,86 @@
+/**********************************************************************
+ *  iosampler.h
+ **********************************************************************
+ *              Copyright (C) 2025 danko12
+ *
+ *             Author: danko12
+ *          Enhanced cross-platform USB formatting tool
+ *            Modern GUI with improved USB detection
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#pragma once
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+
+#include "diskstats.h"
+
+struct IoRate {
+    double readBytesPerSecond = 0.0;
+    double writeBytesPerSecond = 0.0;
+    double iops = 0.0; // completed requests per second
+    quint64 inflight = 0;
+};
+
+// Stall watchdog settings: FORMATUSB_STALL_TIMEOUT / --stall-timeout SECONDS
+// (0 turns the watchdog off), FORMATUSB_ABORT_ON_STALL=1 / --abort-on-stall
+struct StallPolicy {
+    int seconds = 30;
+    bool abort = false;
+
+    [[nodiscard]] static StallPolicy fromArguments(const QStringList &args);
+};
+
+// Samples the stat counters of every watched device from one timer and reports
+// rates; a device with requests in flight and none completing is flagged stalled
+class IoSampler : public QObject
+{
+    Q_OBJECT
+public:
+    static constexpr int DefaultInterval = 500; // ms
+
+    explicit IoSampler(QObject *parent = nullptr, int intervalMs = DefaultInterval);
+
+    void watch(const QString &name);
+    void unwatch(const QString &name);
+
+    void setStallTimeout(int ms) { stallMs = ms; } // 0 disables the watchdog
+    [[nodiscard]] int stallTimeout() const { return stallMs; }
+
+signals:
+    void sampled(const QString &name, const IoRate &rate);
+    void stalled(const QString &name, qint64 ms, quint64 inflight);
+    void recovered(const QString &name);
+
+private:
+    struct Device {
+        DiskStats last;
+        qint64 sampledAt = 0;
+        qint64 progressAt = 0; // last time a request completed or nothing was queued
+        bool stalled = false;
+    };
+
+    QTimer timer;
+    QElapsedTimer clock;
+    QHash<QString, Device> devices;
+    int stallMs = 0;
+
+    void sample();
+};
@@ -0,0 +1,350 @@
+/**********************************************************************
+ *  jobhistory.cpp
+ **********************************************************************
+ *              Copyright (C) 2025 danko12
+ *
+ *             Author: danko12
+ *          Enhanced cross-platform USB formatting tool
+ *            Modern GUI with improved USB detection
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "jobhistory.h"
+#include "jobmonitor.h"
+
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QLocale>
+#include <QLockFile>
+#include <QStandardPaths>
+#include <QTextStream>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace
+{
+const QByteArray segmentMagic("FUSBHIS1"); // 8 byte header of every segment
+constexpr int RecordSize = 64;
+constexpr int PhaseSlots = 16;
+constexpr quint8 NoPhase = 0xFF;
+
+// status byte, 0 and 1 were written as the old ok flag
+constexpr quint8 StatusFailed = 0;
+constexpr quint8 StatusOk = 1;
+constexpr quint8 StatusCancelled = 2;
+
+// Record layout (little endian):
+//   0 u32 time   4 u32 serial   8 u32 model   12 u32 port   16 u32 format
+//  20 u32 elapsed ms   24 u32 KiB written   28 u8 status   29 u8 failed phase   30 u16 reserved
+//  32 u16[16] phase durations in 100 ms units, indexed by phaseSlots
+// Only ever append to phaseSlots, the position is the on-disk slot.
+const QStringList phaseSlots {"check", "unmount", "inhibit", "wipe", "partition", "format",
+                              "label", "retype", "log", "release", "flush",
+                              "stamp", "backup"};
+
+quint16 tenthsOfSecond(qint64 ms)
+{
+    return quint16(qMin<qint64>((ms + 50) / 100, 0xFFFF));
+}
+
+QString formatRate(double bytesPerSecond)
+{
+    return QLocale().formattedDataSize(qint64(bytesPerSecond), 1, QLocale::DataSizeTraditionalFormat) + "/s";
+}
+}
+
+JobHistory::JobHistory(const QString &dir)
+    : dir(dir.isEmpty() ? QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/history" : dir)
+{
+    QDir().mkpath(this->dir);
+    loadKeys();
+    pruneSegments();
+}
+
+// incremental: only lines past the ones already known are added
+void JobHistory::loadKeys() const
+{
+    QFile file(dir + "/keys.txt");
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    const QList<QByteArray> lines = file.readAll().split('\n');
+    // the last element is the empty remainder after the final newline
+    for (int id = keys.size(); id < lines.size() - 1; ++id) {
+        keys << QString::fromUtf8(lines.at(id));
+        keyIds.insert(keys.last(), quint32(id));
+    }
+}
+
+// callers hold the history lock, so ids stay unique across processes
+quint32 JobHistory::intern(const QString &key)
+{
+    const QString clean = QString(key).replace('\n', ' ');
+    const auto it = keyIds.constFind(clean);
+    if (it != keyIds.constEnd()) {
+        return it.value();
+    }
+
+    QFile file(dir + "/keys.txt");
+    if (file.open(QIODevice::Append)) {
+        file.write(clean.toUtf8() + '\n');
+    }
+    keys << clean;
+    keyIds.insert(clean, quint32(keys.size() - 1));
+    return quint32(keys.size() - 1);
+}
+
+QString JobHistory::segmentPath(const QDate &month) const
+{
+    return QString("%1/history-%2.dat").arg(dir, month.toString("yyyyMM"));
+}
+
+void JobHistory::pruneSegments() const
+{
+    const QString oldest = QFileInfo(segmentPath(QDate::currentDate().addMonths(-RetentionMonths))).fileName();
+    const QStringList segments = QDir(dir).entryList({"history-*.dat"}, QDir::Files, QDir::Name);
+    for (const QString &segment : segments) {
+        if (segment < oldest) {
+            qDebug() << "Dropping job history segment" << segment;
+            QFile::remove(dir + "/" + segment);
+        }
+    }
+}
+
+void JobHistory::append(const JobResult &result)
+{
+    QLockFile lock(dir + "/history.lock");
+    if (!lock.lock()) {
+        qWarning() << "Cannot lock job history in" << dir;
+        return;
+    }
+    loadKeys();
+
+    const int failedSlot = result.ok ? -1 : phaseSlots.indexOf(result.failedPhase);
+    QByteArray record;
+    QDataStream out(&record, QIODevice::WriteOnly);
+    out.setByteOrder(QDataStream::LittleEndian);
+    out << quint32(QDateTime::currentSecsSinceEpoch())
+        << intern(result.device.serial)
+        << intern(result.device.vendorModel())
+        << intern(result.device.busPath)
+        << intern(result.format)
+        << quint32(qMin<qint64>(result.elapsedMs, 0xFFFFFFFF))
+        << quint32(qMin<quint64>(result.bytesWritten / 1024, 0xFFFFFFFF))
+        << (result.ok ? StatusOk : result.cancelled ? StatusCancelled : StatusFailed)
+        << quint8(failedSlot < 0 ? NoPhase : failedSlot)
+        << quint16(0);
+
+    QVector<quint16> phases(PhaseSlots, 0);
+    for (const PhaseTiming &timing : result.phases) {
+        const int slot = phaseSlots.indexOf(timing.phase);
+        if (slot >= 0 && slot < PhaseSlots) {
+            phases[slot] = tenthsOfSecond(qint64(phases.at(slot)) * 100 + timing.ms);
+        }
+    }
+    for (quint16 ms : phases) {
+        out << ms;
+    }
+
+    QFile segment(segmentPath(QDate::currentDate()));
+    const bool fresh = !segment.exists();
+    if (!segment.open(QIODevice::Append)) {
+        qWarning() << "Cannot write job history" << segment.fileName() << segment.errorString();
+        return;
+    }
+    segment.write(fresh ? segmentMagic + record : record);
+}
+
+void JobHistory::scan(const QDateTime &since, const std::function<void(const Entry &)> &visit) const
+{
+    // records appended by another instance may reference keys it interned since
+    {
+        QLockFile lock(dir + "/history.lock");
+        if (!lock.lock()) {
+            qWarning() << "Cannot lock job history in" << dir;
+        }
+        loadKeys();
+    }
+
+    const quint32 from = quint32(qMax<qint64>(0, since.toSecsSinceEpoch()));
+    const QString first = QFileInfo(segmentPath(since.date())).fileName();
+    const QStringList segments = QDir(dir).entryList({"history-*.dat"}, QDir::Files, QDir::Name);
+
+    for (const QString &name : segments) {
+        if (name < first) {
+            continue;
+        }
+        QFile segment(dir + "/" + name);
+        if (!segment.open(QIODevice::ReadOnly) || segment.size() < segmentMagic.size()) {
+            continue;
+        }
+        const uchar *data = segment.map(0, segment.size());
+        if (!data || QByteArray::fromRawData(reinterpret_cast<const char *>(data), segmentMagic.size()) != segmentMagic) {
+            continue;
+        }
+
+        const qint64 count = (segment.size() - segmentMagic.size()) / RecordSize;
+        for (qint64 i = 0; i < count; ++i) {
+            const uchar *record = data + segmentMagic.size() + i * RecordSize;
+            const quint32 time = qFromLittleEndian<quint32>(record);
+            if (time < from) {
+                continue;
+            }
+            auto key = [this, record](int offset) {
+                const quint32 id = qFromLittleEndian<quint32>(record + offset);
+                return id < quint32(keys.size()) ? keys.at(int(id)) : QString();
+            };
+
+            Entry entry;
+            entry.time = QDateTime::fromSecsSinceEpoch(time);
+            entry.serial = key(4);
+            entry.model = key(8);
+            entry.port = key(12);
+            entry.format = key(16);
+            entry.elapsedMs = qFromLittleEndian<quint32>(record + 20);
+            entry.bytesWritten = qint64(qFromLittleEndian<quint32>(record + 24)) * 1024;
+            entry.ok = record[28] == StatusOk;
+            entry.cancelled = record[28] == StatusCancelled;
+            entry.failedPhase = record[29] < phaseSlots.size() ? phaseSlots.at(record[29]) : QString();
+            for (int slot = 0; slot < phaseSlots.size(); ++slot) {
+                const quint16 tenths = qFromLittleEndian<quint16>(record + 32 + slot * 2);
+                if (tenths > 0) {
+                    entry.phaseMs.insert(phaseSlots.at(slot), qint64(tenths) * 100);
+                }
+            }
+            visit(entry);
+        }
+    }
+}
+
+QString JobHistory::slowestPorts(int days, int limit) const
+{
+    struct Port {
+        QString name;
+        int jobs = 0;
+        qint64 elapsedMs = 0;
+        qint64 bytes = 0;
+    };
+    QHash<QString, Port> ports;
+
+    scan(QDateTime::currentDateTime().addDays(-days), [&ports](const Entry &entry) {
+        if (!entry.ok || entry.port.isEmpty()) {
+            return;
+        }
+        Port &port = ports[entry.port];
+        port.name = entry.port;
+        ++port.jobs;
+        port.elapsedMs += entry.elapsedMs;
+        port.bytes += entry.bytesWritten;
+    });
+
+    QList<Port> sorted = ports.values();
+    std::sort(sorted.begin(), sorted.end(), [](const Port &a, const Port &b) {
+        // MB/s as double, bytes * ms overflows for large devices and long jobs
+        auto rate = [](const Port &port) {
+            return port.elapsedMs > 0 ? double(port.bytes) / 1e6 / (double(port.elapsedMs) / 1000.0) : 0.0;
+        };
+        return rate(a) < rate(b); // lowest throughput first
+    });
+
+    QString report;
+    QTextStream out(&report);
+    out << QString("Slowest ports, last %1 days\n").arg(days);
+    out << QString("%1 %2 %3 %4\n").arg(QString("PORT"), -28).arg(QString("JOBS"), 6).arg(QString("AVG TIME"), 10).arg(QString("THROUGHPUT"), 12);
+    for (const Port &port : sorted.mid(0, limit)) {
+        out << QString("%1 %2 %3 %4\n")
+                   .arg(port.name, -28)
+                   .arg(port.jobs, 6)
+                   .arg(QString::number(double(port.elapsedMs) / port.jobs / 1000.0, 'f', 1) + "s", 10)
+                   .arg(formatRate(port.elapsedMs > 0 ? port.bytes * 1000.0 / port.elapsedMs : 0), 12);
+    }
+    return report;
+}
+
+QString JobHistory::failureRateByModel(int days) const
+{
+    struct Model {
+        QString name;
+        int jobs = 0;
+        int failures = 0;
+        QHash<QString, int> phases;
+    };
+    QHash<QString, Model> models;
+
+    scan(QDateTime::currentDateTime().addDays(-days), [&models](const Entry &entry) {
+        if (entry.cancelled) {
+            return; // stopped by the user, says nothing about the model
+        }
+        const QString name = entry.model.isEmpty() ? QString("(unknown)") : entry.model;
+        Model &model = models[name];
+        model.name = name;
+        ++model.jobs;
+        if (!entry.ok) {
+            ++model.failures;
+            ++model.phases[entry.failedPhase.isEmpty() ? QString("start") : entry.failedPhase];
+        }
+    });
+
+    QList<Model> sorted = models.values();
+    std::sort(sorted.begin(), sorted.end(), [](const Model &a, const Model &b) {
+        return qint64(a.failures) * b.jobs > qint64(b.failures) * a.jobs; // highest rate first
+    });
+
+    QString report;
+    QTextStream out(&report);
+    out << QString("Failure rate by model, last %1 days\n").arg(days);
+    out << QString("%1 %2 %3 %4 %5\n").arg(QString("MODEL"), -28).arg(QString("JOBS"), 6).arg(QString("FAILED"), 7).arg(QString("RATE"), 7).arg(QString("TOP PHASE"));
+    for (const Model &model : sorted) {
+        QString topPhase;
+        for (auto it = model.phases.cbegin(); it != model.phases.cend(); ++it) {
+            if (topPhase.isEmpty() || it.value() > model.phases.value(topPhase)) {
+                topPhase = it.key();
+            }
+        }
+        out << QString("%1 %2 %3 %4 %5\n")
+                   .arg(model.name, -28)
+                   .arg(model.jobs, 6)
+                   .arg(model.failures, 7)
+                   .arg(QString::number(100.0 * model.failures / model.jobs, 'f', 1) + "%", 7)
+                   .arg(topPhase);
+    }
+    return report;
+}
+
+int JobHistory::runQuery(const QStringList &args)
+{
+    auto option = [&args](const QString &name, int fallback) {
+        const int i = args.indexOf(name);
+        return (i >= 0 && i + 1 < args.size()) ? args.at(i + 1).toInt() : fallback;
+    };
+    const QString query = args.value(0);
+    const int days = option("--days", 7);
+    const JobHistory history;
+
+    QTextStream out(stdout);
+    if (query == "slowest-ports") {
+        out << history.slowestPorts(days, option("--limit", 20));
+    } else if (query == "failure-rate") {
+        out << history.failureRateByModel(days);
+    } else {
+        out << "Usage: formatusb --history slowest-ports|failure-rate [--days N] [--limit N]\n";
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
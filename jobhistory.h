@@ -0,0 +1,85 @@
+/**********************************************************************
+ *  jobhistory.h
+ **********************************************************************
+ *              Copyright (C) 2025 danko12
+ *
+ *             Author: danko12
+ *          Enhanced cross-platform USB formatting tool
+ *            Modern GUI with improved USB detection
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#pragma once
+
+#include <QDateTime>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+#include <functional>
+
+struct JobResult;
+
+// Append-only store of finished jobs, one 64 byte record per job.
+//
+// Records live in monthly segments (history-YYYYMM.dat) so queries only scan
+// the months they cover and old months are dropped whole. Serials, models,
+// ports and formats are interned in keys.txt, one string per line, and
+// referenced by line number.
+class JobHistory
+{
+public:
+    // one decoded record
+    struct Entry {
+        QDateTime time;
+        QString serial;
+        QString model;
+        QString port;
+        QString format;
+        bool ok = false;
+        bool cancelled = false;
+        QString failedPhase;
+        qint64 elapsedMs = 0;
+        qint64 bytesWritten = 0;
+        QHash<QString, qint64> phaseMs;
+    };
+
+    explicit JobHistory(const QString &dir = QString());
+
+    void append(const JobResult &result);
+
+    // visit every record newer than since, oldest first
+    void scan(const QDateTime &since, const std::function<void(const Entry &)> &visit) const;
+
+    // text reports shared by the History dialog and the command line
+    [[nodiscard]] QString slowestPorts(int days, int limit) const;
+    [[nodiscard]] QString failureRateByModel(int days) const;
+
+    // formatusb --history slowest-ports|failure-rate [--days N] [--limit N]
+    static int runQuery(const QStringList &args);
+
+    static constexpr int RetentionMonths = 13;
+
+private:
+    QString dir;
+    // grows as other instances sharing the store intern new strings
+    mutable QStringList keys;
+    mutable QHash<QString, quint32> keyIds;
+
+    void loadKeys() const;
+    [[nodiscard]] quint32 intern(const QString &key);
+    [[nodiscard]] QString segmentPath(const QDate &month) const;
+    void pruneSegments() const;
+};
@@ -0,0 +1,128 @@
+/**********************************************************************
+ *  jobmonitor.cpp
+ **********************************************************************
+ *              Copyright (C) 2025 danko12
+ *
+ *             Author: danko12
+ *          Enhanced cross-platform USB formatting tool
+ *            Modern GUI with improved USB detection
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "jobmonitor.h"
+
+#include <QDebug>
+
+namespace
+{
+const QString phaseMarker = "::phase ";
+}
+
+double JobResult::throughput() const
+{
+    return elapsedMs > 0 ? double(bytesWritten) * 1000.0 / double(elapsedMs) : 0.0;
+}
+
+JobMonitor::JobMonitor(QObject *parent)
+    : QObject(parent)
+{
+}
+
+void JobMonitor::start(const DeviceInfo &device, const QString &format)
+{
+    result = JobResult();
+    result.device = device;
+    result.format = format;
+    phase.clear();
+    pending.clear();
+    haveStats = DiskStats::read(device.name, startStats);
+    jobClock.start();
+    emit jobStarted(device);
+}
+
+QString JobMonitor::feed(const QString &output)
+{
+    const QString text = pending + output;
+    QString visible;
+    pending.clear();
+
+    int start = 0;
+    while (start < text.size()) {
+        const int end = text.indexOf('\n', start);
+        if (end < 0) {
+            const QString tail = text.mid(start);
+            if (phaseMarker.startsWith(tail) || tail.startsWith(phaseMarker)) {
+                pending = tail;
+            } else {
+                visible += tail;
+            }
+            break;
+        }
+        const QString line = text.mid(start, end - start);
+        if (line.startsWith(phaseMarker)) {
+            startPhase(line.mid(phaseMarker.size()).trimmed());
+        } else {
+            visible += text.mid(start, end - start + 1);
+        }
+        start = end + 1;
+    }
+    return visible;
+}
+
+void JobMonitor::finish(bool ok, bool cancelled)
+{
+    if (!jobClock.isValid()) {
+        return;
+    }
+    if (!ok) {
+        result.failedPhase = phase.isEmpty() ? QString("start") : phase;
+    }
+    closePhase();
+
+    DiskStats endStats;
+    if (haveStats && DiskStats::read(result.device.name, endStats)) {
+        result.bytesWritten = endStats.bytesWritten() - startStats.bytesWritten();
+    }
+    result.ok = ok;
+    result.cancelled = cancelled;
+    result.elapsedMs = jobClock.elapsed();
+    jobClock.invalidate();
+
+    qDebug().noquote() << QString("Job on %1 %2 after %3 ms, %4 bytes written")
+                              .arg(result.device.name, ok ? QString("finished")
+                                                       : (cancelled ? "cancelled in " : "failed in ") + result.failedPhase)
+                              .arg(result.elapsedMs)
+                              .arg(result.bytesWritten);
+    emit jobFinished(result);
+}
+
+void JobMonitor::startPhase(const QString &name)
+{
+    closePhase();
+    phase = name;
+    phaseClock.start();
+    emit phaseStarted(name);
+}
+
+void JobMonitor::closePhase()
+{
+    if (phase.isEmpty()) {
+        return;
+    }
+    const qint64 ms = phaseClock.elapsed();
+    result.phases << PhaseTiming {phase, ms};
+    emit phaseFinished(phase, ms);
+    phase.clear();
+}
@@ -0,0 +1,87 @@
+/**********************************************************************
+ *  jobmonitor.h
+ **********************************************************************
+ *              Copyright (C) 2025 danko12
+ *
+ *             Author: danko12
+ *          Enhanced cross-platform USB formatting tool
+ *            Modern GUI with improved USB detection
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#pragma once
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QString>
+
+#include "devicemodel.h"
+#include "diskstats.h"
+
+struct PhaseTiming {
+    QString phase;
+    qint64 ms = 0;
+};
+
+// Outcome of one run of formatusb_lib on one device
+struct JobResult {
+    DeviceInfo device;
+    QString format;
+    bool ok = false;
+    bool cancelled = false; // stopped on request, not a failure
+    QString failedPhase; // phase that failed or was cancelled
+    QList<PhaseTiming> phases;
+    qint64 elapsedMs = 0;
+    quint64 bytesWritten = 0;
+
+    [[nodiscard]] double throughput() const; // bytes per second
+};
+
+// Follows a running job through the "::phase <name>" markers formatusb_lib
+// prints, timing each phase and measuring what was written to the device
+class JobMonitor : public QObject
+{
+    Q_OBJECT
+public:
+    explicit JobMonitor(QObject *parent = nullptr);
+
+    void start(const DeviceInfo &device, const QString &format);
+
+    // consume script output, returns it with the marker lines removed
+    [[nodiscard]] QString feed(const QString &output);
+
+    void finish(bool ok, bool cancelled = false);
+
+    [[nodiscard]] QString currentPhase() const { return phase; }
+
+signals:
+    void jobStarted(const DeviceInfo &device);
+    void phaseStarted(const QString &phase);
+    void phaseFinished(const QString &phase, qint64 ms);
+    void jobFinished(const JobResult &result);
+
+private:
+    JobResult result;
+    QString phase;
+    QString pending; // incomplete line that may still turn into a marker
+    QElapsedTimer jobClock;
+    QElapsedTimer phaseClock;
+    DiskStats startStats;
+    bool haveStats = false;
+
+    void startPhase(const QString &name);
+    void closePhase();
+};
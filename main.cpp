@@ -35,6 +35,10 @@
 #include <cstdlib>
 
 #include "mainwindow.h"
+#include "goldentemplate.h"
+#include "jobhistory.h"
+#include "selftest.h"
+#include "metrics.h"
 #include <version.h>
 #include <unistd.h>
 
@@ -43,6 +47,22 @@ void messageHandler(QtMsgType type, const QMessageLogContext &context, const QSt
 
 int main(int argc, char *argv[])
 {
+    // history queries run headless on stations without a display
+    if (argc > 1 && QString(argv[1]) == "--history") {
+        QCoreApplication core(argc, argv);
+        return JobHistory::runQuery(core.arguments().mid(2));
+    }
+    // simulated devices only, runs without root or hardware (CI)
+    if (argc > 1 && QString(argv[1]) == "--self-test") {
+        QCoreApplication core(argc, argv);
+        return SelfTest::run(core.arguments().mid(2));
+    }
+    // invoked as root by formatusb_lib to stamp a cached template onto a device
+    if (argc > 1 && QString(argv[1]) == "--stamp-template") {
+        QCoreApplication core(argc, argv);
+        return GoldenTemplate::runCommand(core.arguments().mid(2));
+    }
+
     // Set Qt platform to XCB (X11) if not already set and we're in X11 environment
     if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
         if (!qEnvironmentVariableIsEmpty("DISPLAY") && qEnvironmentVariableIsEmpty("WAYLAND_DISPLAY")) {
@@ -77,6 +97,14 @@ int main(int argc, char *argv[])
 
     qDebug() << "Program Version:" << VERSION;
 
+    // Prometheus textfile for unattended stations
+    QString metrics_file = qEnvironmentVariable("FORMATUSB_METRICS_TEXTFILE");
+    const int metrics_arg = a.arguments().indexOf("--metrics-textfile");
+    if (metrics_arg >= 0 && metrics_arg + 1 < a.arguments().size()) {
+        metrics_file = a.arguments().at(metrics_arg + 1);
+    }
+    Metrics::enable(metrics_file);
+
         MainWindow w;
         w.show();
         return a.exec();
@@ -23,13 +23,17 @@
 
 #include "mainwindow.h"
 #include "about.h"
+#include "blockdevice.h"
+#include "metrics.h"
 #include "ui_mainwindow.h"
 #include "version.h"
 
 #include <QApplication>
+#include <QCheckBox>
 #include <QCoreApplication>
 #include <QFileDialog>
 #include <QScrollBar>
+#include <QSignalBlocker>
 #include <QTextStream>
 #include <QDebug>
 #include <QString>
@@ -38,14 +42,64 @@
 #include <QRegularExpression>
 #include <QStandardPaths>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QTimer>
 #include <QProcess>
 #include <QFileInfo>
 #include <QFile>
 #include <QIODevice>
 #include <QMessageBox>
+#include <QHash>
+#include <QHeaderView>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSortFilterProxyModel>
+#include <QIcon>
+#include <QPlainTextEdit>
+#include <QPushButton>
+#include <QVBoxLayout>
 #include <unistd.h>
 
+#include <algorithm>
+
+namespace
+{
+// single quote an argument for the bash -c command line; the label, layout
+// and backup directory are typed or picked by the user
+QString shellQuote(const QString &arg)
+{
+    QString quoted = arg;
+    return "'" + quoted.replace("'", "'\\''") + "'";
+}
+
+// lsblk prints flags as "1"/"0" in older releases and as JSON booleans in newer ones
+bool jsonFlag(const QJsonValue &value)
+{
+    return value.isBool() ? value.toBool() : value.toVariant().toString() == "1";
+}
+
+// USB port (e.g. usb-2-1.4) when attached through USB, otherwise the PCI function of the controller
+QString busPathOf(const QString &name)
+{
+    static const QRegularExpression usbPort("/(\\d+-[\\d.]+)(?=/)");
+    static const QRegularExpression pciFunction("/([0-9a-f]{4}:[0-9a-f]{2}:[0-9a-f]{2}\\.[0-9a-f])(?=/)");
+
+    const QString path = QFileInfo("/sys/class/block/" + name).canonicalFilePath();
+    QString port;
+    for (auto it = usbPort.globalMatch(path); it.hasNext();) {
+        port = it.next().captured(1);
+    }
+    if (!port.isEmpty()) {
+        return "usb-" + port;
+    }
+    for (auto it = pciFunction.globalMatch(path); it.hasNext();) {
+        port = it.next().captured(1);
+    }
+    return port.isEmpty() ? QString() : "pci-" + port;
+}
+}
+
 MainWindow::MainWindow()
     : ui(new Ui::MainWindow)
 {
@@ -53,12 +107,13 @@ MainWindow::MainWindow()
     ui->setupUi(this);
     setWindowFlags(Qt::Window); // for the close, min and max buttons
     setup();
-    ui->comboBoxUsbList->addItems(buildUsbList());
+    deviceModel->setDevices(buildUsbList());
     this->adjustSize();
 }
 
 MainWindow::~MainWindow()
 {
+    delete history;
     delete ui;
 }
 
@@ -99,6 +154,64 @@ void MainWindow::setup()
     ui->outputBox->setCursorWidth(0);
     height = this->heightMM();
     ui->lineEditFSlabel->setText("USB-DATA");
+
+    deviceModel = new DeviceModel(this);
+    deviceProxy = new QSortFilterProxyModel(this);
+    deviceProxy->setSourceModel(deviceModel);
+    deviceProxy->setSortRole(DeviceModel::SortRole);
+    deviceProxy->setFilterKeyColumn(-1); // match any column
+    deviceProxy->setFilterCaseSensitivity(Qt::CaseInsensitive);
+    ui->tableViewDevices->setModel(deviceProxy);
+    ui->tableViewDevices->sortByColumn(DeviceModel::Name, Qt::AscendingOrder);
+    ui->tableViewDevices->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    connect(ui->lineEditFilter, &QLineEdit::textChanged, deviceProxy, &QSortFilterProxyModel::setFilterFixedString);
+
+    // mounts and swap decide which drives are protected, follow them without polling mount(8)
+    topology = new DriveTopology(this);
+    contentProbe = new ContentProbe(this);
+
+    ui->comboBoxLayout->addItems(layoutPresets());
+
+    jobMonitor = new JobMonitor(this);
+    history = new JobHistory();
+    connect(jobMonitor, &JobMonitor::jobFinished, this, [this](const JobResult &result) {
+        history->append(result);
+    });
+    if (Metrics::enabled()) {
+        connect(jobMonitor, &JobMonitor::jobStarted, this, &Metrics::jobStarted);
+        connect(jobMonitor, &JobMonitor::phaseFinished, this, &Metrics::phaseFinished);
+        connect(jobMonitor, &JobMonitor::jobFinished, this, &Metrics::jobFinished);
+    }
+
+    // live rates and the stall watchdog for the device being formatted
+    stallPolicy = StallPolicy::fromArguments(qApp->arguments());
+    ioSampler = new IoSampler(this);
+    ioSampler->setStallTimeout(stallPolicy.seconds * 1000);
+    connect(jobMonitor, &JobMonitor::jobStarted, this, [this](const DeviceInfo &device) {
+        ui->labelIo->clear();
+        ioSampler->watch(device.name);
+    });
+    connect(jobMonitor, &JobMonitor::jobFinished, this, [this](const JobResult &result) {
+        ioSampler->unwatch(result.device.name);
+    });
+    connect(ioSampler, &IoSampler::sampled, this, &MainWindow::showIoRate);
+    connect(ioSampler, &IoSampler::stalled, this, &MainWindow::deviceStalled);
+    connect(ioSampler, &IoSampler::recovered, this, [this](const QString &name) {
+        ui->outputBox->appendPlainText(tr("/dev/%1 is making progress again.\n").arg(name));
+    });
+    connect(topology, &DriveTopology::changed, this, [this]() {
+        deviceModel->setDevices(buildUsbList());
+    });
+
+    // contents are probed once per device and re-read when a uevent reports a change;
+    // a format produces bursts of them, so refresh the list once they settle
+    auto *contentRefresh = new QTimer(this);
+    contentRefresh->setSingleShot(true);
+    contentRefresh->setInterval(300);
+    connect(contentProbe, &ContentProbe::changed, contentRefresh, qOverload<>(&QTimer::start));
+    connect(contentRefresh, &QTimer::timeout, this, [this]() {
+        deviceModel->setDevices(buildUsbList());
+    });
     
     // Modern compact styling
     setStyleSheet(
@@ -133,6 +246,12 @@ void MainWindow::setup()
         "   background-color: white; "
         "} "
         "QLineEdit:focus { border-color: #007bff; } "
+        "QTableView { "
+        "   border: 2px solid #dee2e6; "
+        "   border-radius: 6px; "
+        "   background-color: white; "
+        "   selection-background-color: #007bff; "
+        "} "
         "QLabel { color: #495057; font-weight: 500; } "
         "QCheckBox { color: #6c757d; } "
         "QPlainTextEdit { "
@@ -144,94 +263,121 @@ void MainWindow::setup()
     );
     
     // Make window more compact
-    setMaximumSize(800, 500);
+    setMaximumSize(1200, 800);
     setMinimumSize(600, 400);
 }
 
-// Enhanced USB device detection
-QStringList MainWindow::getRemovableDevices()
+// Enumerate disks and partitions with a single lsblk call
+QList<DeviceInfo> MainWindow::getBlockDevices()
 {
-    QStringList devices;
+    QList<DeviceInfo> devices;
     QProcess process;
-    
-    // Enhanced lsblk command for better USB detection
-    QString cmd = "lsblk -ndo NAME,SIZE,MODEL,VENDOR,TYPE,HOTPLUG,RM -I 3,8,22,179,259 2>/dev/null";
-    process.start("bash", QStringList() << "-c" << cmd);
+
+    process.start("lsblk", QStringList() << "-J" << "-l" << "-b" << "-o"
+                  << "NAME,PKNAME,TYPE,SIZE,VENDOR,MODEL,SERIAL,TRAN,HOTPLUG,RM,FSTYPE,LABEL,MOUNTPOINT"
+                  << "-I" << "3,8,22,179,259");
     process.waitForFinished(5000);
-    
-    if (process.exitCode() == 0) {
-        QString output = process.readAllStandardOutput();
-        QStringList lines = output.split('\n', Qt::SkipEmptyParts);
-        
-        for (const QString &line : lines) {
-            QStringList parts = line.split(QRegularExpression("\\s+"), Qt::SkipEmptyParts);
-            if (parts.count() >= 6) {
-                QString device = parts.at(0);
-                QString size = parts.at(1);
-                QString hotplug = parts.at(5);
-                QString removable = parts.at(6);
-                
-                // Check if device is USB/removable
-                if (isUsbDevice(device) || hotplug == "1" || removable == "1") {
-                    QString info = QString("%1 (%2)").arg(device, size);
-                    if (parts.count() > 2 && !parts.at(2).isEmpty()) {
-                        info += " " + parts.at(2);
-                    }
-                    if (parts.count() > 3 && !parts.at(3).isEmpty()) {
-                        info += " " + parts.at(3);
-                    }
-                    devices << info;
+
+    if (process.exitCode() != 0) {
+        return devices;
+    }
+
+    const QJsonArray entries = QJsonDocument::fromJson(process.readAllStandardOutput())
+                                   .object().value("blockdevices").toArray();
+    QHash<QString, int> disks; // disk name -> index in devices
+    bool usedHidden = false; // a filesystem described by udev, without its used space
+
+    for (const QJsonValue &value : entries) {
+        const QJsonObject entry = value.toObject();
+        const QString type = entry.value("type").toString();
+        if (type != "disk" && type != "part") {
+            continue;
+        }
+
+        DeviceInfo dev;
+        dev.name = entry.value("name").toString();
+        dev.size = entry.value("size").toVariant().toLongLong();
+        dev.fstype = entry.value("fstype").toString();
+        dev.label = entry.value("label").toString();
+        dev.mountpoint = entry.value("mountpoint").toString();
+        dev.busPath = busPathOf(dev.name);
+        dev.partition = (type == "part");
+        const DeviceContents contents = contentProbe->contents(dev.name);
+        dev.contents = contents.summary();
+        dev.uuid = contents.uuid;
+        usedHidden = usedHidden || (contents.fromUdev && !contents.fstype.isEmpty());
+
+        if (!dev.partition) {
+            dev.vendor = entry.value("vendor").toString().trimmed();
+            dev.model = entry.value("model").toString().trimmed();
+            dev.serial = entry.value("serial").toString().trimmed();
+            dev.usb = entry.value("tran").toString() == "usb" || jsonFlag(entry.value("hotplug"))
+                      || jsonFlag(entry.value("rm")) || dev.busPath.startsWith("usb-");
+            disks.insert(dev.name, devices.size());
+        } else {
+            // partitions inherit the identity of their disk, which lsblk lists first
+            dev.parent = entry.value("pkname").toString();
+            const int disk = disks.value(dev.parent, -1);
+            if (disk >= 0) {
+                DeviceInfo &parent = devices[disk];
+                dev.vendor = parent.vendor;
+                dev.model = parent.model;
+                dev.serial = parent.serial;
+                dev.usb = parent.usb;
+                if (parent.mountpoint.isEmpty()) {
+                    parent.mountpoint = dev.mountpoint;
                 }
+                // a disk lists its table followed by what each partition holds
+                parent.contents += (parent.contents.contains(": ") ? "; " : ": ") + dev.contents;
             }
         }
+        devices << dev;
     }
-    
-    return devices;
-}
 
-bool MainWindow::isUsbDevice(const QString &device)
-{
-    QProcess process;
-    
-    // Method 1: Check /sys/block for removable attribute
-    QString sysPath = QString("/sys/block/%1/removable").arg(device);
-    QFile removableFile(sysPath);
-    if (removableFile.open(QIODevice::ReadOnly)) {
-        QString content = removableFile.readAll().trimmed();
-        if (content == "1") {
-            return true;
+    // image files given with --image stand in for disks, the library attaches them as loop devices
+    const QStringList args = QApplication::arguments();
+    for (int i = args.indexOf("--image"); i >= 0 && i + 1 < args.size(); i = args.indexOf("--image", i + 2)) {
+        // the library formats through parted and mkfs, which a sim: profile cannot reach
+        if (args.at(i + 1).startsWith("sim:")) {
+            qDebug() << "Skipping simulated device" << args.at(i + 1) << "- use --self-test";
+            continue;
         }
-    }
-    
-    // Method 2: Use udevadm for detailed device info
-    process.start("udevadm", QStringList() << "info" << "--query=property" << "--name=" + device);
-    process.waitForFinished(3000);
-    
-    if (process.exitCode() == 0) {
-        QString output = process.readAllStandardOutput();
-        if (output.contains("ID_BUS=usb") || output.contains("ID_USB_DRIVER=usb-storage")) {
-            return true;
+        const QString path = QFileInfo(args.at(i + 1)).absoluteFilePath();
+        const auto image = BlockDevice::open(path, false);
+        if (!image) {
+            qDebug() << "Skipping image" << path;
+            continue;
         }
+        DeviceInfo dev;
+        dev.name = path;
+        dev.size = image->size();
+        dev.model = tr("Image file");
+        dev.busPath = "image";
+        dev.usb = true;
+        dev.contents = contentProbe->contents(path).summary();
+        devices << dev;
     }
-    
-    // Method 3: Check device path for USB connection
-    QString devicePath = QString("/sys/block/%1").arg(device);
-    QFileInfo pathInfo(devicePath);
-    if (pathInfo.exists()) {
-        QString realPath = pathInfo.canonicalFilePath();
-        if (realPath.contains("/usb")) {
-            return true;
-        }
+
+    // reading superblocks needs access to /dev/sdX, which belongs to root:disk
+    ui->labelUsedSpace->setVisible(usedHidden);
+    return devices;
+}
+
+QList<DeviceInfo> MainWindow::selectedDevices() const
+{
+    QList<DeviceInfo> devices;
+    QModelIndexList rows = ui->tableViewDevices->selectionModel()->selectedRows();
+    std::sort(rows.begin(), rows.end()); // keep the order the operator sees
+
+    for (const QModelIndex &index : rows) {
+        devices << deviceModel->device(deviceProxy->mapToSource(index).row());
     }
-    
-    return false;
+    return devices;
 }
 
 // Build the option list to be passed to formatting script
 QString MainWindow::buildOptionList()
 {
-    device = ui->comboBoxUsbList->currentText().split(" ").at(0);
-    device = device.replace("(", "").replace(")", "");
     label = ui->lineEditFSlabel->text();
     QString partoption;
     QString options;
@@ -267,15 +413,22 @@ QString MainWindow::buildOptionList()
 }
 
 
-    options = QString("%1 \"%2\" \"%3\" \"%4\" \"%5\" \"%6\"")
-              .arg(authentication)
-              .arg(scriptPath)
-              .arg(device)
-              .arg(format)
-              .arg(label)
-              .arg(partoption);
+    // one arg() call, so a % in the label is not taken for a later placeholder
+    options = QString("%1 %2 %3 %4 %5 %6")
+              .arg(authentication, shellQuote(scriptPath), shellQuote(device),
+                   shellQuote(format), shellQuote(label), shellQuote(partoption));
 
     
+    if (!selectedLayout().isEmpty()) {
+        options += " " + shellQuote("--layout=" + selectedLayout());
+    }
+    if (partoption != "part" && ui->checkBoxTemplate->isChecked()) {
+        options += " --template";
+    }
+    if (!backupDir.isEmpty()) {
+        options += " " + shellQuote("--backup=" + backupDir);
+    }
+
     options = options.trimmed();
     qDebug() << "Device:" << device << "Format:" << format << "Label:" << label;
     qDebug() << "Options:" << options;
@@ -290,103 +443,157 @@ void MainWindow::cleanup()
 }
 
 // build the USB list with improved detection
-QStringList MainWindow::buildUsbList()
+QList<DeviceInfo> MainWindow::buildUsbList()
 {
-    if (ui->checkBoxshowpartitions->isChecked()) {
-        QString drives = cmd->getCmdOut("lsblk -nlo NAME,SIZE,LABEL,TYPE -I 3,8,22,179,259 |grep -v disk");
-        return removeUnsuitable(drives.split("\n"));
-    } else {
-        return removeUnsuitable(getRemovableDevices());
+    const bool partitions = ui->checkBoxshowpartitions->isChecked();
+    QList<DeviceInfo> devices;
+    QElapsedTimer timer;
+    timer.start();
+
+    {
+        // swaps are not watched, so re-read here; changed() would rebuild this list again
+        const QSignalBlocker blocker(topology);
+        topology->update();
     }
+
+    for (const DeviceInfo &dev : getBlockDevices()) {
+        if (dev.partition == partitions) {
+            devices << dev;
+        }
+    }
+    devices = removeUnsuitable(devices);
+
+    if (Metrics::enabled()) {
+        Metrics::enumerationFinished(timer.elapsed());
+    }
+    return devices;
 }
 
 // remove unsuitable drives from the list (live and unremovable)
-QStringList MainWindow::removeUnsuitable(const QStringList &devices)
+QList<DeviceInfo> MainWindow::removeUnsuitable(const QList<DeviceInfo> &devices)
 {
-    QStringList list;
-    QString name;
+    QList<DeviceInfo> list;
     bool showall = ui->checkBoxShowAll->isChecked();
-    
-    for (const QString &line : devices) {
-        if (line.trimmed().isEmpty()) continue;
-        
-        name = line.split(" ").at(0);
-        name = name.replace("(", "").replace(")", "");
-        
-        if (!showall) {
-            if (isUsbDevice(name)) {
-                // Additional safety check - don't list system drives
-                if (!isSystemDrive(name)) {
-                    list << line;
-                }
-            }
-        } else {
-            if (!isSystemDrive(name)) {
-                list << line;
-            }
+
+    for (const DeviceInfo &dev : devices) {
+        if (!showall && !dev.usb) {
+            continue;
+        }
+        // Additional safety check - don't list system drives
+        if (!isSystemDrive(dev.name)) {
+            list << dev;
         }
     }
-    
+
     return list;
 }
 
 bool MainWindow::isSystemDrive(const QString &device)
 {
-    QProcess process;
-    
-    // Check if device is mounted as root filesystem
-    process.start("bash", QStringList() << "-c" << QString("mount | grep '/dev/%1' | grep ' / '").arg(device));
-    process.waitForFinished(3000);
-    
-    if (process.exitCode() == 0 && !process.readAllStandardOutput().isEmpty()) {
-        return true; // This is the root filesystem
-    }
-    
-    // Check if device contains boot partitions
-    process.start("bash", QStringList() << "-c" << QString("mount | grep '/dev/%1' | grep '/boot'").arg(device));
-    process.waitForFinished(3000);
-    
-    if (process.exitCode() == 0 && !process.readAllStandardOutput().isEmpty()) {
-        return true; // This contains boot partition
-    }
-    
-    return false;
+    return topology->isCritical(device);
 }
 
 void MainWindow::cmdStart()
 {
     setCursor(QCursor(Qt::WaitCursor));
     ui->buttonNext->setEnabled(false);
-    ui->buttonBack->setEnabled(false);
+    ui->buttonBack->setText(tr("Cancel"));
+    ui->buttonBack->setEnabled(true);
 }
 
 void MainWindow::cmdDone()
 {
-    setCursor(QCursor(Qt::ArrowCursor));
-    ui->buttonBack->setEnabled(true);
-    
-    if (cmd && cmd->exitCode() == 0 && cmd->exitStatus() == QProcess::NormalExit) {
-       QMessageBox::information(this, tr("Success"),
-    tr("USB device has been formatted successfully!\n\nYou can now safely remove the device.\n\nThank you for using this tool!"));
-
-        
-        // Refresh device list
-        ui->comboBoxUsbList->clear();
-        ui->comboBoxUsbList->addItems(buildUsbList());
-    } else {
-        QString errorMsg = tr("Error occurred during formatting process.");
+    const bool ok = cmd && cmd->exitCode() == 0 && cmd->exitStatus() == QProcess::NormalExit;
+    // an aborted job exits like a cancelled one, but the hung device is a failure
+    const bool aborted = jobAborted && !ok;
+    const bool cancelled = !aborted && cmd && cmd->exitStatus() == QProcess::NormalExit && cmd->exitCode() == ExitCancelled;
+    QString errorMsg;
+
+    jobAborted = false;
+
+    jobMonitor->finish(ok, cancelled);
+
+    if (cancelled) {
+        ++jobCancels;
+        ui->outputBox->appendPlainText(tr("Formatting /dev/%1 was cancelled.\n").arg(device));
+    } else if (aborted) {
+        ++jobFailures;
+        errorMsg = tr("/dev/%1 stopped responding and was left as it is.").arg(device);
+        ui->outputBox->appendPlainText(tr("Formatting /dev/%1 was aborted, the device stopped responding.\n").arg(device));
+    } else if (!ok) {
+        ++jobFailures;
+        errorMsg = tr("Error occurred during formatting process.");
         if (cmd) {
             QString stderr_output = cmd->readAllStandardError();
             if (!stderr_output.isEmpty()) {
                 errorMsg += "\n\nDetails:\n" + stderr_output;
             }
         }
-        QMessageBox::critical(this, tr("Formatting Failed"), errorMsg);
+        ui->outputBox->appendPlainText(tr("Formatting /dev/%1 failed.\n").arg(device));
     }
-    
+
     if (cmd) {
         cmd->disconnect();
     }
+
+    // continue with the next selected device
+    if (startNextJob()) {
+        return;
+    }
+
+    setCursor(QCursor(Qt::ArrowCursor));
+    ui->buttonBack->setText(tr("Back"));
+    ui->buttonBack->setEnabled(true);
+
+    if (cancelled) {
+        // formatusb_lib only rolls back what it touched: a partition loses its
+        // filesystem signature, a whole device gets an empty partition table
+        QMessageBox::information(this, tr("Cancelled"),
+                                 ui->checkBoxshowpartitions->isChecked()
+                                     ? tr("Formatting was cancelled.\n\nThe partly written filesystem signature has been removed from the partition.")
+                                     : tr("Formatting was cancelled.\n\nA partly formatted device is left with an empty partition table."));
+    } else if (jobCount > 1) {
+        QString summary = tr("%1 of %2 devices have been formatted successfully.").arg(jobCount - jobFailures - jobCancels).arg(jobCount);
+        if (jobCancels > 0) {
+            summary += tr(" %1 cancelled.").arg(jobCancels);
+        }
+        if (jobFailures == 0) {
+            QMessageBox::information(this, tr("Success"), summary + tr("\n\nYou can now safely remove the devices."));
+        } else {
+            QMessageBox::warning(this, tr("Formatting Failed"), summary + tr("\n\nSee the output for the failed devices."));
+        }
+    } else if (ok) {
+       QMessageBox::information(this, tr("Success"),
+    tr("USB device has been formatted successfully!\n\nYou can now safely remove the device.\n\nThank you for using this tool!"));
+    } else {
+        QMessageBox::critical(this, tr("Formatting Failed"), errorMsg);
+    }
+
+    // Refresh device list
+    deviceModel->setDevices(buildUsbList());
+}
+
+// start formatting the next queued device, false when nothing was started
+bool MainWindow::startNextJob()
+{
+    if (jobQueue.isEmpty()) {
+        return false;
+    }
+
+    const DeviceInfo next = jobQueue.takeFirst();
+    device = next.name;
+    QString options = buildOptionList();
+    if (options.isEmpty()) {
+        jobQueue.clear();
+        return false;
+    }
+
+    jobMonitor->start(next, selectedLayout().isEmpty() ? ui->comboBoxDataFormat->currentText()
+                                                       : "layout:" + selectedLayout());
+
+    ui->outputBox->appendPlainText(tr("Formatting /dev/%1...\n").arg(device));
+    makeUsb(options);
+    return true;
 }
 
 void MainWindow::setConnections()
@@ -403,7 +610,7 @@ void MainWindow::updateOutput()
 {
     if (!cmd) return;
     
-    QString out = cmd->readAllStandardOutput();
+    QString out = jobMonitor->feed(cmd->readAllStandardOutput());
     
     // Clean ANSI escape sequences for better display
     QRegularExpression ansiEscape("\\x1b\\[[0-9;]*[mK]");
@@ -422,30 +629,44 @@ void MainWindow::on_buttonNext_clicked()
 {
     // on first page
     if (ui->stackedWidget->currentIndex() == 0) {
-        if (ui->comboBoxUsbList->currentText().isEmpty()) {
+        const QList<DeviceInfo> devices = selectedDevices();
+        if (devices.isEmpty()) {
             QMessageBox::critical(this, tr("Error"), tr("Please select a USB device to format"));
             return;
         }
 
         // Enhanced confirmation dialog
-        QString deviceInfo = ui->comboBoxUsbList->currentText();
+        QStringList deviceInfo;
+        for (const DeviceInfo &dev : devices) {
+            deviceInfo << dev.summary();
+        }
         QString msg = tr("WARNING: This action will PERMANENTLY DESTROY all data on:\n\n")
-                      + deviceInfo + "\n\n" 
-                      + tr("Format: %1\nLabel: %2\n\n").arg(
-                          ui->comboBoxDataFormat->currentText(),
-                          ui->lineEditFSlabel->text()
-                      )
+                      + deviceInfo.join("\n") + "\n\n" 
+                      + (selectedLayout().isEmpty()
+                             ? tr("Format: %1\nLabel: %2\n\n").arg(
+                                 ui->comboBoxDataFormat->currentText(),
+                                 ui->lineEditFSlabel->text()
+                             )
+                             : tr("Layout: %1\n\n").arg(selectedLayout()))
                       + tr("Are you absolutely sure you want to continue?");
         
-        QMessageBox::StandardButton reply = QMessageBox::warning(
-            this, "Confirm USB Format", msg, 
-            QMessageBox::Yes | QMessageBox::No, 
-            QMessageBox::No
-        );
-        
-        if (reply != QMessageBox::Yes) {
+        QMessageBox confirm(QMessageBox::Warning, "Confirm USB Format", msg,
+                            QMessageBox::Yes | QMessageBox::No, this);
+        confirm.setDefaultButton(QMessageBox::No);
+        auto *backup = new QCheckBox(tr("Back up the used space of each device first"), &confirm);
+        confirm.setCheckBox(backup);
+
+        if (confirm.exec() != QMessageBox::Yes) {
             return;
         }
+
+        backupDir.clear();
+        if (backup->isChecked()) {
+            backupDir = QFileDialog::getExistingDirectory(this, tr("Save backups in"), QDir::homePath());
+            if (backupDir.isEmpty()) {
+                return;
+            }
+        }
         
         if (cmd && cmd->state() != QProcess::NotRunning) {
             ui->stackedWidget->setCurrentWidget(ui->outputPage);
@@ -459,29 +680,73 @@ void MainWindow::on_buttonNext_clicked()
         ui->outputBox->clear();
         ui->outputBox->appendPlainText("Starting USB formatting process...\n");
 
-        QString options = buildOptionList();
-        if (options.isEmpty()) {
+        jobQueue = devices;
+        jobCount = devices.size();
+        jobFailures = 0;
+        jobCancels = 0;
+        if (!startNextJob()) {
             QMessageBox::critical(this, tr("Error"), tr("Failed to build formatting options."));
             on_buttonBack_clicked();
             return;
         }
-        
-        makeUsb(options);
     }
 }
 
 void MainWindow::on_buttonBack_clicked()
 {
+    if (cmd && cmd->state() != QProcess::NotRunning) {
+        cancelJob();
+        return;
+    }
+
     this->setWindowTitle("USB FORMAT v" + QString(VERSION));
     ui->stackedWidget->setCurrentIndex(0);
     ui->buttonNext->setEnabled(true);
     ui->buttonBack->setDisabled(true);
     ui->outputBox->clear();
-    
-    // Stop any running processes
-    if (cmd && cmd->state() != QProcess::NotRunning) {
-        cmd->kill();
-        cmd->waitForFinished(3000);
+}
+
+// ask the running job to stop; the library kills its current phase, rolls the
+// device back and re-enables automount, cmdDone() runs once it has exited
+void MainWindow::cancelJob()
+{
+    jobQueue.clear();
+    ui->buttonBack->setEnabled(false);
+    ui->outputBox->appendPlainText(tr("Cancelling...\n"));
+    // pkexec runs the library as root, so it cannot be signalled from here
+    cmd->write("cancel\n");
+}
+
+// stop a job whose device hung; a rollback would hang too, so the library
+// leaves the device as it is. The rest of the batch carries on
+void MainWindow::abortJob()
+{
+    if (jobAborted) {
+        return;
+    }
+    jobAborted = true;
+    ui->outputBox->appendPlainText(tr("Aborting /dev/%1...\n").arg(device));
+    cmd->write("abort\n");
+}
+
+void MainWindow::showIoRate(const QString &name, const IoRate &rate)
+{
+    ui->labelIo->setText(tr("/dev/%1: write %2 MB/s, read %3 MB/s, %4 IOPS, %5 in flight")
+                             .arg(name)
+                             .arg(rate.writeBytesPerSecond / 1e6, 0, 'f', 1)
+                             .arg(rate.readBytesPerSecond / 1e6, 0, 'f', 1)
+                             .arg(qRound(rate.iops))
+                             .arg(rate.inflight));
+}
+
+// requests are queued but none completed for the stall timeout: a hung device,
+// not a slow one
+void MainWindow::deviceStalled(const QString &name, qint64 ms, quint64 inflight)
+{
+    ui->outputBox->appendPlainText(tr("Warning: /dev/%1 has not completed any I/O for %2 s with %3 requests in flight, the device may be hung.\n")
+                                       .arg(name).arg(ms / 1000).arg(inflight));
+    if (stallPolicy.abort && name == device && cmd && cmd->state() != QProcess::NotRunning) {
+        abortJob();
     }
 }
 
@@ -507,6 +772,28 @@ void MainWindow::on_buttonHelp_clicked()
     displayDoc(url, tr("%1 Help").arg(this->windowTitle()), true);
 }
 
+// History button clicked
+void MainWindow::on_buttonHistory_clicked()
+{
+    QDialog dialog(this);
+    dialog.setWindowTitle(tr("Job History"));
+    dialog.resize(700, 450);
+
+    QPlainTextEdit *text = new QPlainTextEdit;
+    text->setReadOnly(true);
+    text->setPlainText(history->slowestPorts(7, 20) + "\n" + history->failureRateByModel(7));
+
+    QPushButton *btnClose = new QPushButton(tr("&Close"));
+    btnClose->setIcon(QIcon::fromTheme("window-close"));
+    connect(btnClose, &QPushButton::clicked, &dialog, &QDialog::close);
+
+    QVBoxLayout *layout = new QVBoxLayout;
+    layout->addWidget(text);
+    layout->addWidget(btnClose);
+    dialog.setLayout(layout);
+    dialog.exec();
+}
+
 void MainWindow::on_buttonRefresh_clicked()
 {
     ui->buttonRefresh->setEnabled(false);
@@ -514,8 +801,7 @@ void MainWindow::on_buttonRefresh_clicked()
     
     // Add a small delay to show user that detection is happening
     QTimer::singleShot(500, this, [this]() {
-        ui->comboBoxUsbList->clear();
-        ui->comboBoxUsbList->addItems(buildUsbList());
+        deviceModel->setDevices(buildUsbList());
         ui->buttonRefresh->setEnabled(true);
         ui->buttonRefresh->setText(tr("Refresh"));
     });
@@ -530,6 +816,9 @@ void MainWindow::on_checkBoxshowpartitions_clicked()
 {
     on_buttonRefresh_clicked();
     ui->comboBoxPartitionTableType->setEnabled(!ui->checkBoxshowpartitions->isChecked());
+    ui->comboBoxLayout->setEnabled(!ui->checkBoxshowpartitions->isChecked());
+    ui->checkBoxTemplate->setEnabled(!ui->checkBoxshowpartitions->isChecked());
+    on_comboBoxLayout_currentIndexChanged(ui->comboBoxLayout->currentIndex());
 }
 
 void MainWindow::validate_name()
@@ -577,3 +866,35 @@ void MainWindow::on_comboBoxDataFormat_currentIndexChanged(int)
 {
     validate_name();
 }
+
+// a layout preset brings its own formats and labels
+void MainWindow::on_comboBoxLayout_currentIndexChanged(int)
+{
+    const bool single = selectedLayout().isEmpty();
+    ui->comboBoxDataFormat->setEnabled(single);
+    ui->lineEditFSlabel->setEnabled(single);
+}
+
+// layout preset chosen for whole-device jobs, empty for a single partition
+QString MainWindow::selectedLayout() const
+{
+    if (!ui->comboBoxLayout->isEnabled() || ui->comboBoxLayout->currentIndex() <= 0) {
+        return QString();
+    }
+    return ui->comboBoxLayout->currentText();
+}
+
+// preset names from the directories formatusb_lib searches
+QStringList MainWindow::layoutPresets() const
+{
+    QStringList presets;
+    const QStringList dirs {"/etc/formatusb/layouts", "/usr/local/share/formatusb/layouts", "/usr/share/formatusb/layouts"};
+    for (const QString &dir : dirs) {
+        for (const QFileInfo &file : QDir(dir).entryInfoList({"*.layout"}, QDir::Files, QDir::Name)) {
+            if (!presets.contains(file.completeBaseName())) {
+                presets << file.completeBaseName();
+            }
+        }
+    }
+    return presets;
+}
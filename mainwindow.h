@@ -37,6 +37,14 @@
 #include <QApplication>
 
 #include <cmd.h>
+#include <contentprobe.h>
+#include <devicemodel.h>
+#include <drivetopology.h>
+#include <iosampler.h>
+#include <jobhistory.h>
+#include <jobmonitor.h>
+
+class QSortFilterProxyModel;
 
 const QString cli_utils = QString(". ")
                           + (QFile::exists("/usr/local/lib/cli-shell-utils/cli-shell-utils.bash")
@@ -59,12 +67,14 @@ public:
     void makeUsb(const QString &options);
     void setup();
     QString buildOptionList();
-    QStringList buildUsbList();
-    QStringList getRemovableDevices();
-    bool isUsbDevice(const QString &device);
+    QList<DeviceInfo> buildUsbList();
+    QList<DeviceInfo> getBlockDevices();
+    QList<DeviceInfo> selectedDevices() const;
+    QString selectedLayout() const;
+    QStringList layoutPresets() const;
     bool isSystemDrive(const QString &device);
     void validate_name();
-    QStringList removeUnsuitable(const QStringList &devices); // remove unsuitable disks from the list (live and unremovable)
+    QList<DeviceInfo> removeUnsuitable(const QList<DeviceInfo> &devices); // remove unsuitable disks from the list (live and unremovable)
 
 private slots:
     void cleanup();
@@ -75,6 +85,7 @@ private slots:
     void on_buttonAbout_clicked();
     void on_buttonBack_clicked();
     void on_buttonHelp_clicked();
+    void on_buttonHistory_clicked();
     void on_buttonNext_clicked();
     void on_buttonRefresh_clicked();
     void on_checkBoxShowAll_clicked();
@@ -82,12 +93,35 @@ private slots:
 
     void on_lineEditFSlabel_textChanged(const QString &arg1);
     void on_comboBoxDataFormat_currentIndexChanged(int index);
+    void on_comboBoxLayout_currentIndexChanged(int index);
 
 private:
     Ui::MainWindow *ui;
     Cmd *cmd;
     Cmd *cmdprog;
+    DeviceModel *deviceModel;
+    DriveTopology *topology;
+    ContentProbe *contentProbe;
+    JobMonitor *jobMonitor;
+    IoSampler *ioSampler;
+    StallPolicy stallPolicy;
+    JobHistory *history;
+    QSortFilterProxyModel *deviceProxy;
+    QList<DeviceInfo> jobQueue; // devices still waiting to be formatted in this run
+    int jobCount = 0;
+    int jobFailures = 0;
+    int jobCancels = 0;
+    bool jobAborted = false; // abort sent to the running job after a stall
     QString device;
     QString label;
+    QString backupDir; // where formatusb_lib saves a backup before formatting, empty for none
     int height;
+
+    static constexpr int ExitCancelled = 130; // formatusb_lib exit code after a cancel
+
+    bool startNextJob();
+    void cancelJob();
+    void abortJob();
+    void showIoRate(const QString &name, const IoRate &rate);
+    void deviceStalled(const QString &name, qint64 ms, quint64 inflight);
 };
@@ -0,0 +1,202 @@
+/**********************************************************************
+ *  metrics.cpp
+ **********************************************************************
+ *              Copyright (C) 2025 danko12
+ *
+ *             Author: danko12
+ *          Enhanced cross-platform USB formatting tool
+ *            Modern GUI with improved USB detection
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "metrics.h"
+#include "jobmonitor.h"
+
+#include <QDebug>
+#include <QSaveFile>
+#include <QTextStream>
+#include <QTimer>
+
+namespace
+{
+struct MetricInfo {
+    const char *type;
+    const char *help;
+    QVector<double> buckets; // upper bounds, histograms only
+    bool labelled = false;   // every series carries labels, there is no unlabelled one
+};
+
+const QMap<QString, MetricInfo> &registry()
+{
+    static const QMap<QString, MetricInfo> metrics {
+        {"formatusb_jobs_started_total", {"counter", "Format jobs started.", {}}},
+        {"formatusb_jobs_succeeded_total", {"counter", "Format jobs that completed successfully.", {}}},
+        {"formatusb_jobs_failed_total", {"counter", "Format jobs that failed, by failing phase.", {}, true}},
+        {"formatusb_jobs_cancelled_total", {"counter", "Format jobs cancelled by the user, by phase.", {}, true}},
+        {"formatusb_bytes_written_total", {"counter", "Bytes written to target devices.", {}}},
+        {"formatusb_phase_duration_seconds", {"histogram", "Duration of each job phase.",
+                                              {0.1, 0.5, 1, 2, 5, 10, 30, 60, 120, 300, 600}, true}},
+        {"formatusb_job_duration_seconds", {"histogram", "Duration of whole format jobs.",
+                                            {1, 5, 10, 20, 30, 60, 120, 300, 600, 1800}}},
+        {"formatusb_device_throughput_bytes_per_second", {"histogram", "Average write throughput of a job.",
+                                                          {1e6, 2e6, 5e6, 10e6, 20e6, 50e6, 100e6, 200e6, 500e6}}},
+        {"formatusb_last_job_throughput_bytes_per_second", {"gauge", "Write throughput of the last job, by port.", {}, true}},
+        {"formatusb_enumeration_duration_seconds", {"histogram", "Time to enumerate and filter block devices.",
+                                                    {0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5}}},
+    };
+    return metrics;
+}
+
+QString label(const QString &name, const QString &value)
+{
+    QString escaped = value;
+    escaped.replace('\\', "\\\\").replace('"', "\\\"").replace('\n', "\\n");
+    return QString("%1=\"%2\"").arg(name, escaped);
+}
+
+QString series(const QString &name, const QString &labels)
+{
+    return labels.isEmpty() ? name : QString("%1{%2}").arg(name, labels);
+}
+}
+
+void Metrics::enable(const QString &path)
+{
+    textfile = path;
+    if (enabled()) {
+        qDebug() << "Exporting metrics to" << textfile;
+        write();
+    }
+}
+
+void Metrics::count(const QString &name, const QString &labels, double delta)
+{
+    values[name][labels] += delta;
+}
+
+void Metrics::set(const QString &name, const QString &labels, double value)
+{
+    values[name][labels] = value;
+}
+
+void Metrics::observe(const QString &name, double value, const QString &labels)
+{
+    const QVector<double> bounds = registry().value(name).buckets;
+    Histogram &histogram = histograms[name][labels];
+    if (histogram.buckets.isEmpty()) {
+        histogram.buckets.fill(0, bounds.size());
+    }
+    for (int i = 0; i < bounds.size(); ++i) {
+        if (value <= bounds.at(i)) {
+            ++histogram.buckets[i];
+        }
+    }
+    histogram.sum += value;
+    ++histogram.count;
+}
+
+void Metrics::jobStarted()
+{
+    count("formatusb_jobs_started_total");
+    write();
+}
+
+void Metrics::phaseFinished(const QString &phase, qint64 ms)
+{
+    observe("formatusb_phase_duration_seconds", double(ms) / 1000.0, label("phase", phase));
+}
+
+void Metrics::jobFinished(const JobResult &result)
+{
+    if (result.ok) {
+        count("formatusb_jobs_succeeded_total");
+    } else if (result.cancelled) {
+        count("formatusb_jobs_cancelled_total", label("phase", result.failedPhase));
+    } else {
+        count("formatusb_jobs_failed_total", label("phase", result.failedPhase));
+    }
+    count("formatusb_bytes_written_total", QString(), double(result.bytesWritten));
+    if (result.cancelled) {
+        write(); // a cut short job would skew the duration and throughput histograms
+        return;
+    }
+    observe("formatusb_job_duration_seconds", double(result.elapsedMs) / 1000.0);
+    if (result.bytesWritten > 0) {
+        observe("formatusb_device_throughput_bytes_per_second", result.throughput());
+        set("formatusb_last_job_throughput_bytes_per_second", label("port", result.device.busPath), result.throughput());
+    }
+    write();
+}
+
+void Metrics::enumerationFinished(qint64 ms)
+{
+    observe("formatusb_enumeration_duration_seconds", double(ms) / 1000.0);
+    // uevent bursts during a format enumerate every few hundred ms
+    scheduleWrite();
+}
+
+void Metrics::scheduleWrite()
+{
+    if (writePending) {
+        return;
+    }
+    writePending = true;
+    QTimer::singleShot(WriteDelayMs, [] {
+        writePending = false;
+        write();
+    });
+}
+
+void Metrics::write()
+{
+    QSaveFile file(textfile);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        qWarning() << "Cannot write metrics to" << textfile << file.errorString();
+        return;
+    }
+
+    QTextStream out(&file);
+    for (auto metric = registry().cbegin(); metric != registry().cend(); ++metric) {
+        const QString &name = metric.key();
+        out << "# HELP " << name << ' ' << metric->help << '\n';
+        out << "# TYPE " << name << ' ' << metric->type << '\n';
+
+        if (metric->buckets.isEmpty()) {
+            const QMap<QString, double> seriesValues = values.value(name);
+            // unlabelled counters are exported from the start so rate() has a baseline
+            if (seriesValues.isEmpty() && QString(metric->type) == "counter" && !metric->labelled) {
+                out << name << " 0\n";
+            }
+            for (auto it = seriesValues.cbegin(); it != seriesValues.cend(); ++it) {
+                out << series(name, it.key()) << ' ' << QString::number(it.value(), 'g', 15) << '\n';
+            }
+            continue;
+        }
+
+        const QMap<QString, Histogram> seriesHistograms = histograms.value(name);
+        for (auto it = seriesHistograms.cbegin(); it != seriesHistograms.cend(); ++it) {
+            const QString prefix = it.key().isEmpty() ? QString() : it.key() + ",";
+            for (int i = 0; i < metric->buckets.size(); ++i) {
+                out << name << "_bucket{" << prefix << label("le", QString::number(metric->buckets.at(i), 'g', 15))
+                    << "} " << it->buckets.at(i) << '\n';
+            }
+            out << name << "_bucket{" << prefix << label("le", "+Inf") << "} " << it->count << '\n';
+            out << series(name + "_sum", it.key()) << ' ' << QString::number(it->sum, 'g', 15) << '\n';
+            out << series(name + "_count", it.key()) << ' ' << it->count << '\n';
+        }
+    }
+    out.flush();
+    file.commit();
+}
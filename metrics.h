@@ -0,0 +1,70 @@
+/**********************************************************************
+ *  metrics.h
+ **********************************************************************
+ *              Copyright (C) 2025 danko12
+ *
+ *             Author: danko12
+ *          Enhanced cross-platform USB formatting tool
+ *            Modern GUI with improved USB detection
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#pragma once
+
+#include <QMap>
+#include <QString>
+#include <QVector>
+
+struct JobResult;
+
+// Counters and histograms exported in Prometheus text format to a file for
+// the node_exporter textfile collector. Disabled unless a path is configured
+// with --metrics-textfile or FORMATUSB_METRICS_TEXTFILE; callers check
+// enabled() first so instrumentation costs a branch when it is off.
+class Metrics
+{
+public:
+    static void enable(const QString &textfile);
+    [[nodiscard]] static bool enabled() { return !textfile.isEmpty(); }
+
+    static void count(const QString &name, const QString &labels = QString(), double delta = 1);
+    static void set(const QString &name, const QString &labels, double value);
+    static void observe(const QString &name, double value, const QString &labels = QString());
+
+    // instrumentation hooks
+    static void jobStarted();
+    static void phaseFinished(const QString &phase, qint64 ms);
+    static void jobFinished(const JobResult &result);
+    static void enumerationFinished(qint64 ms);
+
+    // atomically replace the textfile with the current values
+    static void write();
+    // write() once within WriteDelayMs, for hooks that fire often
+    static void scheduleWrite();
+
+private:
+    struct Histogram {
+        QVector<quint64> buckets;
+        double sum = 0;
+        quint64 count = 0;
+    };
+
+    static constexpr int WriteDelayMs = 2000;
+
+    inline static QString textfile;
+    inline static bool writePending = false;
+    inline static QMap<QString, QMap<QString, double>> values;        // counters and gauges
+    inline static QMap<QString, QMap<QString, Histogram>> histograms;
+};
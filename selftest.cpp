@@ -0,0 +1,263 @@
+/**********************************************************************
+ *  selftest.cpp
+ **********************************************************************
+ *              Copyright (C) 2025 danko12
+ *
+ *             Author: danko12
+ *          Enhanced cross-platform USB formatting tool
+ *            Modern GUI with improved USB detection
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this package. If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "selftest.h"
+#include "blockdevice.h"
+#include "contentprobe.h"
+#include "goldentemplate.h"
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTextStream>
+
+#include <cstdlib>
+#include <functional>
+
+namespace
+{
+constexpr qint64 MiB = 1024 * 1024;
+
+bool makeImage(const QString &path, qint64 size)
+{
+    QFile file(path);
+    return file.open(QIODevice::WriteOnly | QIODevice::Truncate) && file.resize(size);
+}
+
+bool writeAt(BlockDevice &device, qint64 offset, const QByteArray &data)
+{
+    return device.write(offset, data.constData(), data.size()) == data.size();
+}
+
+QByteArray readAt(BlockDevice &device, qint64 offset, qint64 len)
+{
+    QByteArray data(int(len), Qt::Uninitialized);
+    if (device.read(offset, data.data(), len) != len) {
+        return {};
+    }
+    return data;
+}
+
+// a stick that advertises more than it stores wraps later writes onto
+// earlier blocks: tag a block in each quarter and read the tags back
+bool capacityIsReal(BlockDevice &device)
+{
+    const qint64 step = device.size() / 4 / 4096 * 4096;
+    for (int i = 0; i < 4; ++i) {
+        if (!writeAt(device, i * step, QByteArray(4096, char('A' + i)))) {
+            return false;
+        }
+    }
+    for (int i = 0; i < 4; ++i) {
+        if (readAt(device, i * step, 4096) != QByteArray(4096, char('A' + i))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// minimal ext4 superblock, enough for ContentProbe to recognise it
+QByteArray extSuperblock(const QByteArray &label)
+{
+    QByteArray block(1024, '\0');
+    auto put = [&block](int offset, quint32 value) {
+        for (int i = 0; i < 4; ++i) {
+            block[offset + i] = char(value >> (8 * i));
+        }
+    };
+    put(4, 8192);    // blocks
+    put(12, 6144);   // free blocks
+    put(24, 2);      // 4 KiB blocks
+    put(0x60, 0x40); // extents
+    block[56] = char(0x53);
+    block[57] = char(0xEF);
+    block.replace(0x78, label.size(), label);
+    return block;
+}
+}
+
+int SelfTest::run(const QStringList &args)
+{
+    Q_UNUSED(args)
+    QTextStream out(stdout);
+    QTemporaryDir dir;
+    int failures = 0;
+
+    auto check = [&out, &failures](const QString &name, const std::function<bool(QString &)> &test) {
+        QString detail;
+        QElapsedTimer timer;
+        timer.start();
+        const bool ok = test(detail);
+        failures += ok ? 0 : 1;
+        out << (ok ? "PASS " : "FAIL ") << name << " (" << timer.elapsed() << " ms)";
+        if (!detail.isEmpty()) {
+            out << ": " << detail;
+        }
+        out << "\n";
+        out.flush();
+    };
+
+    if (!dir.isValid()) {
+        out << "FAIL cannot create a temporary directory\n";
+        return EXIT_FAILURE;
+    }
+    const QString honest = dir.filePath("honest.img");
+    const QString fake = dir.filePath("fake.img");
+    const QString image = dir.filePath("template.img");
+    const QString target = dir.filePath("target.img");
+
+    check("detect counterfeit capacity", [&](QString &detail) {
+        if (!makeImage(honest, 64 * MiB) || !makeImage(fake, 16 * MiB)) {
+            detail = "cannot create images";
+            return false;
+        }
+        QString error;
+        const auto real = BlockDevice::open("sim:" + honest, true, &error);
+        const auto counterfeit = real ? BlockDevice::open("sim:" + fake + "?capacity=64M", true, &error) : nullptr;
+        if (!counterfeit) {
+            detail = error;
+            return false;
+        }
+        const bool realOk = capacityIsReal(*real);
+        const bool fakeOk = capacityIsReal(*counterfeit);
+        detail = QString("64M image %1, 16M image sold as 64M %2")
+                     .arg(realOk ? "real" : "FAKE", fakeOk ? "real" : "fake");
+        return realOk && !fakeOk;
+    });
+
+    check("discard reads back zeros", [&](QString &detail) {
+        QString error;
+        const auto device = BlockDevice::open("sim:" + honest + "?latency=100us", true, &error);
+        if (!device) {
+            detail = error;
+            return false;
+        }
+        if (!writeAt(*device, MiB, QByteArray(int(MiB), char(0xA5))) || !device->discard(MiB, MiB)) {
+            detail = device->errorString();
+            return false;
+        }
+        return readAt(*device, MiB, MiB) == QByteArray(int(MiB), '\0');
+    });
+
+    check("stamp template and verify", [&](QString &detail) {
+        // template: a superblock, data at 8 MiB and an explicitly written zero block
+        QString error;
+        if (!makeImage(image, 32 * MiB) || !makeImage(target, 32 * MiB)) {
+            detail = "cannot create images";
+            return false;
+        }
+        {
+            const auto source = BlockDevice::open(image, true, &error);
+            const auto stale = source ? BlockDevice::open(target, true, &error) : nullptr;
+            if (!stale || !writeAt(*source, 1024, extSuperblock("SELFTEST"))
+                || !writeAt(*source, 8 * MiB, QByteArray(64 * 1024, char(0x5A)))
+                || !writeAt(*source, 16 * MiB, QByteArray(4096, '\0'))
+                || !writeAt(*stale, 16 * MiB, QByteArray(4096, char(0xFF)))
+                || !writeAt(*stale, 24 * MiB, QByteArray(4096, char(0xFF)))) {
+                detail = error;
+                return false;
+            }
+        }
+
+        if (!GoldenTemplate::stamp(image, "sim:" + target + "?latency=100us", &error)) {
+            detail = error;
+            return false;
+        }
+
+        const auto source = BlockDevice::open(image, false, &error);
+        const auto stamped = source ? BlockDevice::open(target, false, &error) : nullptr;
+        if (!stamped) {
+            detail = error;
+            return false;
+        }
+        for (const GoldenTemplate::Range &range : GoldenTemplate::dataRanges(image)) {
+            if (readAt(*source, range.offset, range.length) != readAt(*stamped, range.offset, range.length)) {
+                detail = QString("extent at %1 differs").arg(range.offset);
+                return false;
+            }
+        }
+        if (readAt(*stamped, 24 * MiB, 4096) != QByteArray(4096, '\0')) {
+            detail = "stale block outside the template was not zeroed";
+            return false;
+        }
+        const DeviceContents contents = ContentProbe::probe("sim:" + target);
+        detail = contents.summary();
+        return contents.fstype == "ext4" && contents.label == "SELFTEST";
+    });
+
+    check("stamp onto a device without discard", [&](QString &detail) {
+        // most USB sticks reject discard and write-zeroes, the gaps must still end up zero
+        QString error;
+        {
+            const auto stale = BlockDevice::open(target, true, &error);
+            if (!stale || !writeAt(*stale, 4 * MiB, QByteArray(int(MiB), char(0xFF)))
+                || !writeAt(*stale, 24 * MiB, QByteArray(4096, char(0xFF)))) {
+                detail = error;
+                return false;
+            }
+        }
+        if (!GoldenTemplate::stamp(image, "sim:" + target + "?no-discard", &error)) {
+            detail = error;
+            return false;
+        }
+        const auto stamped = BlockDevice::open(target, false, &error);
+        if (!stamped) {
+            detail = error;
+            return false;
+        }
+        if (readAt(*stamped, 4 * MiB, MiB) != QByteArray(int(MiB), '\0')
+            || readAt(*stamped, 24 * MiB, 4096) != QByteArray(4096, '\0')) {
+            detail = "stale data left between the template extents";
+            return false;
+        }
+        return readAt(*stamped, 8 * MiB, 64 * 1024) == QByteArray(64 * 1024, char(0x5A));
+    });
+
+    check("stamp stops at a write error", [&](QString &detail) {
+        QString error;
+        const bool ok = GoldenTemplate::stamp(image, "sim:" + target + "?fail-at=8M", &error);
+        detail = error;
+        return !ok;
+    });
+
+    check("stamp throughput cap", [&](QString &detail) {
+        QString error;
+        QElapsedTimer timer;
+        timer.start();
+        if (!GoldenTemplate::stamp(image, "sim:" + target + "?throughput=1M", &error)) {
+            detail = error;
+            return false;
+        }
+        qint64 bytes = 0;
+        for (const GoldenTemplate::Range &range : GoldenTemplate::dataRanges(image)) {
+            bytes += range.length;
+        }
+        const double rate = double(bytes) / qMax<qint64>(timer.elapsed(), 1) * 1000.0 / MiB;
+        detail = QString("%1 MiB/s against a 1 MiB/s cap").arg(rate, 0, 'f', 2);
+        return rate <= 1.1;
+    });
+
+    out << (failures ? QString("%1 self-tests failed\n").arg(failures) : QString("all self-tests passed\n"));
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -31,13 +31,35 @@ TEMPLATE = app
 SOURCES += main.cpp\
     mainwindow.cpp \
     about.cpp \
-    cmd.cpp
+    cmd.cpp \
+    contentprobe.cpp \
+    blockdevice.cpp \
+    devicemodel.cpp \
+    diskstats.cpp \
+    drivetopology.cpp \
+    goldentemplate.cpp \
+    iosampler.cpp \
+    jobhistory.cpp \
+    jobmonitor.cpp \
+    metrics.cpp \
+    selftest.cpp
 
 HEADERS  += \
     mainwindow.h \
     version.h \
     about.h \
-    cmd.h
+    cmd.h \
+    contentprobe.h \
+    blockdevice.h \
+    devicemodel.h \
+    diskstats.h \
+    drivetopology.h \
+    goldentemplate.h \
+    iosampler.h \
+    jobhistory.h \
+    jobmonitor.h \
+    metrics.h \
+    selftest.h
 
 FORMS    += \
     mainwindow.ui